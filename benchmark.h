@@ -0,0 +1,34 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <chrono>
+#include <cstdio>
+
+/**
+ * Prevents the compiler from optimizing away the computation of a value.
+ */
+template<class T>
+inline void do_not_optimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Returns the number of seconds it takes to run the given function once.
+ */
+template<class F>
+double time_seconds(F func) {
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Prints how many units per second were processed by a benchmark.
+ */
+inline void print_rate(const char* name, double units, double seconds,
+		const char* unit) {
+	printf("%-40s %12.3f M%s/s\n", name, units / seconds / 1e6, unit);
+}
+
+#endif /* BENCHMARK_H_ */
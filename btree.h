@@ -0,0 +1,396 @@
+#ifndef BTREE_H_
+#define BTREE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+/**
+ * Returns how many of the n sorted keys are less than key.
+ *
+ * Keys are compared two at a time with SIMD instructions. Longer arrays are
+ * first narrowed down by binary search to a window that a few compares
+ * cover, so a node of any size costs at most a few cache lines.
+ */
+inline size_t count_less(const int64_t* keys, size_t n, int64_t key) {
+	size_t low = 0;
+	while (n > 32) {
+		size_t half = n / 2;
+		if (keys[low + half - 1] < key) {
+			low += half;
+		}
+		n -= half;
+	}
+	size_t count = 0;
+	size_t i = 0;
+#ifdef __SSE2__
+	// Each lane of a compare is -1 where the key is greater, so subtracting
+	// the compares counts the smaller keys in each lane
+	const __m128i k = _mm_set1_epi64x(key);
+	__m128i counts = _mm_setzero_si128();
+	for (; i + 2 <= n; i += 2) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (keys + low + i));
+#ifdef __SSE4_2__
+		__m128i greater = _mm_cmpgt_epi64(k, v);
+#else
+		// Compares the high halves as signed and the low halves as unsigned,
+		// and combines them, since SSE2 only compares 32 bit integers
+		const __m128i flip = _mm_set_epi32(0, INT32_MIN, 0, INT32_MIN);
+		__m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(k, flip),
+				_mm_xor_si128(v, flip));
+		__m128i eq = _mm_cmpeq_epi32(k, v);
+		__m128i greater = _mm_or_si128(
+				_mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1)),
+				_mm_and_si128(_mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1)),
+						_mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0))));
+#endif
+		counts = _mm_sub_epi64(counts, greater);
+	}
+	count = _mm_cvtsi128_si64(counts)
+			+ _mm_cvtsi128_si64(_mm_unpackhi_epi64(counts, counts));
+#endif
+	for (; i < n; i++) {
+		count += keys[low + i] < key;
+	}
+	return low + count;
+}
+
+/**
+ * Ordered map from 64 bit integer keys to values, stored as a B+tree.
+ *
+ * Every node holds up to KeysPerNode keys in one array, so finding a key
+ * in a node reads a few consecutive cache lines instead of following a
+ * pointer per comparison as a binary tree does. Keys past the count of a
+ * node are set to the largest key, so searches need not look at the count.
+ * Values are only in the leaves, and each leaf points to the next one, so
+ * a range is scanned leaf by leaf without going back up the tree.
+ *
+ * The largest int64_t can not be a key. Keys can not be erased.
+ */
+template<class V, size_t KeysPerNode = 32>
+class BPlusTree {
+	static_assert(KeysPerNode >= 4 && KeysPerNode % 2 == 0,
+			"nodes are split in halves");
+
+	static constexpr int64_t no_key = INT64_MAX;
+
+	struct alignas(64) Node {
+		int64_t keys[KeysPerNode];
+		uint32_t count = 0;
+		bool leaf;
+
+		explicit Node(bool leaf) :
+				leaf(leaf) {
+			std::fill(keys, keys + KeysPerNode, no_key);
+		}
+
+		size_t find(int64_t key) const {
+			return count_less(keys, KeysPerNode, key);
+		}
+	};
+
+	struct Leaf: Node {
+		V values[KeysPerNode];
+		Leaf* next = nullptr;
+
+		Leaf() :
+				Node(true) {
+		}
+	};
+
+	struct Inner: Node {
+		// Child i holds the keys from keys[i - 1] up to keys[i]
+		Node* children[KeysPerNode + 1];
+
+		Inner() :
+				Node(false) {
+		}
+	};
+
+	/**
+	 * A new right sibling of a node that was split, and its first key.
+	 */
+	struct Split {
+		int64_t key;
+		Node* right;
+	};
+
+	Node* root = nullptr;
+	size_t count = 0;
+	size_t levels = 0;
+
+	static void destroy(Node* node) {
+		if (node->leaf) {
+			delete (Leaf*) node;
+			return;
+		}
+		Inner* inner = (Inner*) node;
+		for (size_t i = 0; i <= inner->count; i++) {
+			destroy(inner->children[i]);
+		}
+		delete inner;
+	}
+
+	/**
+	 * Returns the leaf that holds the key, if it is in the tree.
+	 */
+	const Leaf* find_leaf(int64_t key) const {
+		const Node* node = root;
+		while (!node->leaf) {
+			// Keys equal to a separator are on its right
+			const Inner* inner = (const Inner*) node;
+			node = inner->children[key < no_key ? inner->find(key + 1) : inner->count];
+		}
+		return (const Leaf*) node;
+	}
+
+	Split insert_into_leaf(Leaf* leaf, int64_t key, const V& value,
+			bool& inserted) {
+		size_t i = leaf->find(key);
+		if (i < leaf->count && leaf->keys[i] == key) {
+			leaf->values[i] = value;
+			inserted = false;
+			return {0, nullptr};
+		}
+		inserted = true;
+		Split split { 0, nullptr };
+		if (leaf->count == KeysPerNode) {
+			// Moves the upper half to a new leaf
+			Leaf* right = new Leaf;
+			const size_t half = KeysPerNode / 2;
+			for (size_t j = half; j < KeysPerNode; j++) {
+				right->keys[j - half] = leaf->keys[j];
+				right->values[j - half] = std::move(leaf->values[j]);
+				leaf->keys[j] = no_key;
+			}
+			leaf->count = half;
+			right->count = KeysPerNode - half;
+			right->next = leaf->next;
+			leaf->next = right;
+			split = {right->keys[0], right};
+			if (i > half) {
+				leaf = right;
+				i -= half;
+			}
+		}
+		for (size_t j = leaf->count; j > i; j--) {
+			leaf->keys[j] = leaf->keys[j - 1];
+			leaf->values[j] = std::move(leaf->values[j - 1]);
+		}
+		leaf->keys[i] = key;
+		leaf->values[i] = value;
+		leaf->count++;
+		return split;
+	}
+
+	Split insert_into(Node* node, int64_t key, const V& value, bool& inserted) {
+		if (node->leaf) {
+			return insert_into_leaf((Leaf*) node, key, value, inserted);
+		}
+		Inner* inner = (Inner*) node;
+		size_t c = inner->find(key + 1);
+		Split below = insert_into(inner->children[c], key, value, inserted);
+		if (!below.right) {
+			return {0, nullptr};
+		}
+
+		if (inner->count < KeysPerNode) {
+			for (size_t j = inner->count; j > c; j--) {
+				inner->keys[j] = inner->keys[j - 1];
+				inner->children[j + 1] = inner->children[j];
+			}
+			inner->keys[c] = below.key;
+			inner->children[c + 1] = below.right;
+			inner->count++;
+			return {0, nullptr};
+		}
+
+		// Splits a full node: the middle key moves up, and the keys and
+		// children on its right move to a new node
+		int64_t keys[KeysPerNode + 1];
+		Node* children[KeysPerNode + 2];
+		std::copy(inner->keys, inner->keys + c, keys);
+		keys[c] = below.key;
+		std::copy(inner->keys + c, inner->keys + KeysPerNode, keys + c + 1);
+		std::copy(inner->children, inner->children + c + 1, children);
+		children[c + 1] = below.right;
+		std::copy(inner->children + c + 1, inner->children + KeysPerNode + 1,
+				children + c + 2);
+
+		const size_t middle = KeysPerNode / 2;
+		Inner* right = new Inner;
+		std::fill(inner->keys, inner->keys + KeysPerNode, no_key);
+		std::copy(keys, keys + middle, inner->keys);
+		std::copy(children, children + middle + 1, inner->children);
+		inner->count = middle;
+		std::copy(keys + middle + 1, keys + KeysPerNode + 1, right->keys);
+		std::copy(children + middle + 1, children + KeysPerNode + 2,
+				right->children);
+		right->count = KeysPerNode - middle;
+		return {keys[middle], right};
+	}
+public:
+	BPlusTree() = default;
+
+	BPlusTree(const BPlusTree&) = delete;
+	BPlusTree& operator=(const BPlusTree&) = delete;
+
+	~BPlusTree() {
+		if (root) {
+			destroy(root);
+		}
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * Returns the number of levels of nodes, from the root to the leaves.
+	 */
+	size_t height() const {
+		return levels;
+	}
+
+	/**
+	 * Returns the value of the key, or null if the key is absent.
+	 */
+	const V* find(int64_t key) const {
+		if (!root) {
+			return nullptr;
+		}
+		const Leaf* leaf = find_leaf(key);
+		size_t i = leaf->find(key);
+		return i < leaf->count && leaf->keys[i] == key ? &leaf->values[i] : nullptr;
+	}
+
+	/**
+	 * Sets the value of the key, returning true if the key is new.
+	 */
+	bool insert(int64_t key, const V& value) {
+		assert(key != no_key);
+		if (!root) {
+			root = new Leaf;
+			levels = 1;
+		}
+		bool inserted;
+		Split split = insert_into(root, key, value, inserted);
+		if (split.right) {
+			Inner* new_root = new Inner;
+			new_root->keys[0] = split.key;
+			new_root->children[0] = root;
+			new_root->children[1] = split.right;
+			new_root->count = 1;
+			root = new_root;
+			levels++;
+		}
+		count += inserted;
+		return inserted;
+	}
+
+	/**
+	 * Calls func with the key and value of every key in [low, high), in
+	 * order.
+	 */
+	template<class F>
+	void for_range(int64_t low, int64_t high, F func) const {
+		if (!root) {
+			return;
+		}
+		const Leaf* leaf = find_leaf(low);
+		for (size_t i = leaf->find(low); leaf; leaf = leaf->next, i = 0) {
+			for (; i < leaf->count; i++) {
+				if (leaf->keys[i] >= high) {
+					return;
+				}
+				func(leaf->keys[i], leaf->values[i]);
+			}
+		}
+	}
+
+	/**
+	 * Replaces the contents of the tree with n pairs of keys and values
+	 * sorted by strictly increasing keys.
+	 *
+	 * The tree is built bottom up: the leaves are filled in order, then
+	 * each level of inner nodes over the one below. This is much faster
+	 * than inserting one key at a time, and every node is full, or nearly,
+	 * so the tree is as small and as shallow as it can be.
+	 */
+	void bulk_load(const std::pair<int64_t, V>* pairs, size_t n) {
+		if (root) {
+			destroy(root);
+			root = nullptr;
+		}
+		count = n;
+		levels = 0;
+		if (n == 0) {
+			return;
+		}
+
+		// Spreads the items evenly over the fewest nodes that hold them
+		auto spread = [](size_t items, size_t per_node, auto make_node) {
+			size_t nodes = (items + per_node - 1) / per_node;
+			size_t first = 0;
+			for (size_t k = 0; k < nodes; k++) {
+				size_t size = items / nodes + (k < items % nodes);
+				make_node(first, size);
+				first += size;
+			}
+		};
+
+		std::vector<Node*> level;
+		std::vector<int64_t> first_keys;
+		Leaf* previous = nullptr;
+		spread(n, KeysPerNode, [&](size_t first, size_t size) {
+			Leaf* leaf = new Leaf;
+			for (size_t i = 0; i < size; i++) {
+				assert(pairs[first + i].first != no_key);
+				assert(first + i == 0
+						|| pairs[first + i - 1].first < pairs[first + i].first);
+				leaf->keys[i] = pairs[first + i].first;
+				leaf->values[i] = pairs[first + i].second;
+			}
+			leaf->count = size;
+			if (previous) {
+				previous->next = leaf;
+			}
+			previous = leaf;
+			level.push_back(leaf);
+			first_keys.push_back(leaf->keys[0]);
+		});
+		levels = 1;
+
+		while (level.size() > 1) {
+			std::vector<Node*> parents;
+			std::vector<int64_t> parent_keys;
+			spread(level.size(), KeysPerNode + 1, [&](size_t first, size_t size) {
+				Inner* inner = new Inner;
+				for (size_t i = 0; i < size; i++) {
+					inner->children[i] = level[first + i];
+					if (i > 0) {
+						inner->keys[i - 1] = first_keys[first + i];
+					}
+				}
+				inner->count = size - 1;
+				parents.push_back(inner);
+				parent_keys.push_back(first_keys[first]);
+			});
+			level.swap(parents);
+			first_keys.swap(parent_keys);
+			levels++;
+		}
+		root = level[0];
+	}
+};
+
+#endif /* BTREE_H_ */
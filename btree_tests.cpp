@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "benchmark.h"
+#include "btree.h"
+#include "btree_tests.h"
+#include "person_index.h"
+
+using namespace std;
+
+/**
+ * Tests counting keys in nodes of every size up to a few windows, with
+ * negative keys and keys that differ only in their low or high half.
+ */
+void test_count_less(void) {
+	mt19937_64 random(1);
+	for (size_t n = 0; n <= 100; n++) {
+		vector<int64_t> keys(n);
+		for (int64_t& key : keys) {
+			key = (int64_t) random() >> (random() % 64);
+		}
+		sort(keys.begin(), keys.end());
+		for (size_t i = 0; i < n; i++) {
+			for (int64_t probe : { keys[i] - 1, keys[i], keys[i] + 1,
+					keys[i] ^ 0x80000000 }) {
+				size_t expected = lower_bound(keys.begin(), keys.end(), probe)
+						- keys.begin();
+				assert(count_less(keys.data(), n, probe) == expected);
+			}
+		}
+		assert(count_less(keys.data(), n, INT64_MIN) == 0);
+		assert(
+				count_less(keys.data(), n, INT64_MAX)
+						== (size_t) (lower_bound(keys.begin(), keys.end(),
+								INT64_MAX) - keys.begin()));
+	}
+}
+
+/**
+ * Checks that the tree holds exactly the keys and values of the map.
+ */
+template<class Tree>
+void check_same(const Tree& tree, const map<int64_t, int>& expected) {
+	assert(tree.size() == expected.size());
+	auto it = expected.begin();
+	tree.for_range(INT64_MIN, INT64_MAX, [&](int64_t key, int value) {
+		assert(it != expected.end());
+		assert(key == it->first && value == it->second);
+		++it;
+	});
+	assert(it == expected.end());
+	for (const auto& [key, value] : expected) {
+		const int* found = tree.find(key);
+		assert(found && *found == value);
+		assert(!expected.count(key + 1) == !tree.find(key + 1));
+	}
+}
+
+/**
+ * Tests inserting random keys into a tree of small nodes, which splits
+ * often and grows several levels.
+ */
+void test_btree_insert(void) {
+	BPlusTree<int, 4> tree;
+	map<int64_t, int> expected;
+	assert(!tree.find(0));
+	tree.for_range(INT64_MIN, INT64_MAX, [](int64_t, int) {
+		assert(false);
+	});
+
+	mt19937_64 random(2);
+	for (int i = 0; i < 5000; i++) {
+		int64_t key = (int64_t) (random() % 20000) - 10000;
+		bool inserted = expected.insert_or_assign(key, i).second;
+		assert(tree.insert(key, i) == inserted);
+	}
+	check_same(tree, expected);
+	assert(tree.height() >= 5);
+
+	for (int i = 0; i < 100; i++) {
+		int64_t low = (int64_t) (random() % 20000) - 10000;
+		int64_t high = low + random() % 1000;
+		auto it = expected.lower_bound(low);
+		tree.for_range(low, high, [&](int64_t key, int value) {
+			assert(key == it->first && value == it->second);
+			++it;
+		});
+		assert(it == expected.end() || it->first >= high);
+	}
+}
+
+/**
+ * Tests building trees of every size up to a few levels from sorted pairs,
+ * and inserting into them afterwards.
+ */
+template<size_t KeysPerNode>
+void test_btree_bulk_load(void) {
+	for (int n : { 0, 1, 2, 3, 4, 5, 9, 17, 25, 26, 100, 1000 }) {
+		vector<pair<int64_t, int>> pairs;
+		map<int64_t, int> expected;
+		for (int i = 0; i < n; i++) {
+			pairs.push_back({3 * i, i});
+			expected[3 * i] = i;
+		}
+		BPlusTree<int, KeysPerNode> tree;
+		tree.insert(-1, -1);
+		tree.bulk_load(pairs.data(), n);
+		check_same(tree, expected);
+
+		for (int i = 0; i < n; i++) {
+			tree.insert(3 * i + 1, -i);
+			expected[3 * i + 1] = -i;
+		}
+		check_same(tree, expected);
+	}
+}
+
+/**
+ * Tests finding persons by ranges of ages, against a scan of all persons.
+ */
+void test_person_index(void) {
+	mt19937 random(3);
+	vector<Person> persons(2000);
+	for (Person& person : persons) {
+		person.age = random() % 100;
+		person.height = 1.5 + random() % 50 / 100.0;
+	}
+	PersonIndex index;
+	index.build(persons.data(), 1000);
+	for (uint32_t i = 1000; i < persons.size(); i++) {
+		index.add(persons[i], i);
+	}
+	assert(index.size() == persons.size());
+
+	for (auto [low, high] : { pair { 20, 30 }, pair { 0, 0 }, pair { 99, 200 },
+			pair { 50, 40 } }) {
+		size_t count = 0;
+		int last_age = low;
+		index.for_ages(low, high, [&](const Person& person) {
+			assert(person.age >= last_age && person.age <= high);
+			last_age = person.age;
+			count++;
+		});
+		size_t expected = count_if(persons.begin(), persons.end(),
+				[&](const Person& person) {
+					return person.age >= low && person.age <= high;
+				});
+		assert(count == expected);
+	}
+}
+
+void run_btree_tests(void) {
+	test_count_less();
+	test_btree_insert();
+	test_btree_bulk_load<4>();
+	test_btree_bulk_load<32>();
+	test_person_index();
+}
+
+using PersonPair = pair<int64_t, const Person*>;
+
+/**
+ * Index of persons in a standard map.
+ */
+struct MapIndex {
+	map<int64_t, const Person*> persons;
+
+	void build(const vector<PersonPair>& pairs) {
+		persons.insert(pairs.begin(), pairs.end());
+	}
+
+	void insert(int64_t key, const Person* person) {
+		persons.emplace(key, person);
+	}
+
+	const Person* find(int64_t key) const {
+		auto it = persons.find(key);
+		return it == persons.end() ? nullptr : it->second;
+	}
+
+	template<class F>
+	void for_range(int64_t low, int64_t high, F func) const {
+		for (auto it = persons.lower_bound(low);
+				it != persons.end() && it->first < high; ++it) {
+			func(it->first, it->second);
+		}
+	}
+};
+
+/**
+ * Index of persons in a sorted vector, searched by binary search.
+ */
+struct VectorIndex {
+	vector<PersonPair> persons;
+
+	static bool less_key(const PersonPair& pair, int64_t key) {
+		return pair.first < key;
+	}
+
+	void build(const vector<PersonPair>& pairs) {
+		persons = pairs;
+	}
+
+	void insert(int64_t key, const Person* person) {
+		auto it = lower_bound(persons.begin(), persons.end(), key, less_key);
+		persons.insert(it, {key, person});
+	}
+
+	const Person* find(int64_t key) const {
+		auto it = lower_bound(persons.begin(), persons.end(), key, less_key);
+		return it == persons.end() || it->first != key ? nullptr : it->second;
+	}
+
+	template<class F>
+	void for_range(int64_t low, int64_t high, F func) const {
+		for (auto it = lower_bound(persons.begin(), persons.end(), low,
+				less_key); it != persons.end() && it->first < high; ++it) {
+			func(it->first, it->second);
+		}
+	}
+};
+
+/**
+ * Index of persons in a B+tree with nodes of the given size.
+ */
+template<size_t KeysPerNode>
+struct TreeIndex {
+	BPlusTree<const Person*, KeysPerNode> persons;
+
+	void build(const vector<PersonPair>& pairs) {
+		persons.bulk_load(pairs.data(), pairs.size());
+	}
+
+	void insert(int64_t key, const Person* person) {
+		persons.insert(key, person);
+	}
+
+	const Person* find(int64_t key) const {
+		const Person* const * found = persons.find(key);
+		return found ? *found : nullptr;
+	}
+
+	template<class F>
+	void for_range(int64_t low, int64_t high, F func) const {
+		persons.for_range(low, high, func);
+	}
+};
+
+/**
+ * Builds an index of persons by age, then prints the rate of looking up
+ * persons by key, of scanning persons in ranges of ten ages, and of
+ * inserting persons in random order.
+ *
+ * Inserting into a sorted vector moves half of it every time, so it is
+ * only timed for the first inserts.
+ */
+template<class Index>
+void bench_index(const char* name, const vector<PersonPair>& pairs,
+		size_t max_inserts) {
+	size_t n = pairs.size();
+	mt19937_64 random(n);
+	vector<int64_t> probes(1000000);
+	for (int64_t& probe : probes) {
+		probe = pairs[random() % n].first;
+	}
+	vector<PersonPair> shuffled(pairs);
+	shuffle(shuffled.begin(), shuffled.end(), random);
+	shuffled.resize(min(n, max_inserts));
+
+	char label[64];
+	Index* index = new Index;
+	double build = time_seconds([&] {
+		index->build(pairs);
+	});
+	snprintf(label, sizeof(label), "%s %zu build", name, n);
+	print_rate(label, n, build, "persons");
+
+	double lookup = time_seconds([&] {
+		double sum = 0;
+		for (int64_t probe : probes) {
+			sum += index->find(probe)->height;
+		}
+		do_not_optimize(sum);
+	});
+	snprintf(label, sizeof(label), "%s %zu lookup", name, n);
+	print_rate(label, probes.size(), lookup, "ops");
+
+	size_t scanned = 0;
+	double scan = time_seconds([&] {
+		double sum = 0;
+		for (int age = 0; age < 90; age += 3) {
+			index->for_range(person_age_key(age, 0), person_age_key(age + 10, 0),
+					[&](int64_t, const Person* person) {
+						sum += person->height;
+						scanned++;
+					});
+		}
+		do_not_optimize(sum);
+	});
+	snprintf(label, sizeof(label), "%s %zu range scan", name, n);
+	print_rate(label, scanned, scan, "persons");
+	delete index;
+
+	index = new Index;
+	double insert = time_seconds([&] {
+		for (const auto& [key, person] : shuffled) {
+			index->insert(key, person);
+		}
+	});
+	snprintf(label, sizeof(label), "%s %zu insert", name, shuffled.size());
+	print_rate(label, shuffled.size(), insert, "ops");
+	delete index;
+}
+
+void run_btree_benchmarks(void) {
+	// Every index of 10M persons takes up to 1 GB, so that size is only run
+	// on hosts with plenty of memory
+	size_t memory = (size_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+	size_t n = memory >= (size_t) 16 << 30 ? 10000000 : 1000000;
+	mt19937 random(4);
+	vector<Person> persons(n);
+	for (Person& person : persons) {
+		person.age = random() % 100;
+		person.height = 1.5 + random() % 50 / 100.0;
+	}
+	vector<PersonPair> pairs(n);
+	for (uint32_t i = 0; i < n; i++) {
+		pairs[i] = {person_age_key(persons[i].age, i), &persons[i]};
+	}
+	sort(pairs.begin(), pairs.end());
+
+	bench_index<MapIndex>("std::map", pairs, n);
+	bench_index<VectorIndex>("sorted vector", pairs, 100000);
+	// Nodes of 2 and 4 cache lines of keys, and leaves of about a page
+	bench_index<TreeIndex<16>>("BPlusTree<16>", pairs, n);
+	bench_index<TreeIndex<32>>("BPlusTree<32>", pairs, n);
+	bench_index<TreeIndex<256>>("BPlusTree<256>", pairs, n);
+}
@@ -0,0 +1,7 @@
+#ifndef BTREE_TESTS_H_
+#define BTREE_TESTS_H_
+
+void run_btree_tests(void);
+void run_btree_benchmarks(void);
+
+#endif /* BTREE_TESTS_H_ */
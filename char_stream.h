@@ -0,0 +1,103 @@
+#ifndef CHAR_STREAM_H_
+#define CHAR_STREAM_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "generator.h"
+
+/**
+ * Yields the lines of a file, without their line breaks.
+ *
+ * The file is read in chunks into a single buffer that is reused, and lines
+ * are views into that buffer. A view is only valid until the next line is
+ * asked for, so a line must be copied to be kept. The buffer only grows if
+ * a line does not fit in it, so files larger than memory can be read.
+ */
+inline Generator<std::string_view> split_lines(FILE* file, size_t buffer_size =
+		1 << 16) {
+	std::vector<char> buffer(buffer_size);
+	// The unread bytes are [begin, end) and none of [begin, scanned) is '\n'
+	size_t begin = 0;
+	size_t scanned = 0;
+	size_t end = 0;
+	bool eof = false;
+
+	for (;;) {
+		char* data = buffer.data();
+		char* newline = (char*) memchr(data + scanned, '\n', end - scanned);
+		if (newline) {
+			co_yield std::string_view(data + begin, newline - data - begin);
+			begin = scanned = newline - data + 1;
+			continue;
+		}
+		if (eof) {
+			// The last line may have no line break
+			if (begin < end) {
+				co_yield std::string_view(data + begin, end - begin);
+			}
+			co_return;
+		}
+
+		// Moves the partial line to the front, so the rest of the buffer can
+		// be filled, and makes room if the line takes the whole buffer
+		memmove(data, data + begin, end - begin);
+		end -= begin;
+		begin = 0;
+		scanned = end;
+		if (end == buffer.size()) {
+			buffer.resize(buffer.size() * 2);
+		}
+		size_t n = fread(buffer.data() + end, 1, buffer.size() - end, file);
+		eof = n == 0;
+		end += n;
+	}
+}
+
+/**
+ * Yields the tokens of each line, which are the non empty runs of
+ * characters between delimiters.
+ */
+inline Generator<std::string_view> tokenize(Generator<std::string_view> lines,
+		char delimiter = ' ') {
+	for (std::string_view line : lines) {
+		size_t start = 0;
+		while (start < line.size()) {
+			size_t stop = line.find(delimiter, start);
+			if (stop == std::string_view::npos) {
+				stop = line.size();
+			}
+			if (stop > start) {
+				co_yield line.substr(start, stop - start);
+			}
+			start = stop + 1;
+		}
+	}
+}
+
+/**
+ * Yields the items for which pred returns true.
+ */
+template<class T, class Pred>
+Generator<T> filter_stage(Generator<T> items, Pred pred) {
+	for (const T& item : items) {
+		if (pred(item)) {
+			co_yield item;
+		}
+	}
+}
+
+/**
+ * Yields func applied to each item.
+ */
+template<class T, class Func>
+Generator<std::invoke_result_t<Func, const T&>> map_stage(Generator<T> items,
+		Func func) {
+	for (const T& item : items) {
+		co_yield func(item);
+	}
+}
+
+#endif /* CHAR_STREAM_H_ */
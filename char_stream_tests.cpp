@@ -0,0 +1,202 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "benchmark.h"
+#include "char_stream.h"
+#include "char_stream_tests.h"
+#include "generator.h"
+
+using namespace std;
+
+/**
+ * Yields the numbers from 0 up to n.
+ */
+Generator<int> count_to(int n) {
+	for (int i = 0; i < n; i++) {
+		co_yield i;
+	}
+}
+
+/**
+ * Returns a temporary file holding the given text, which is deleted when
+ * the file is closed.
+ */
+static FILE* text_file(const char* text) {
+	FILE* file = tmpfile();
+	assert(file);
+	fputs(text, file);
+	rewind(file);
+	return file;
+}
+
+/**
+ * Tests a generator, which produces its values only as they are asked for.
+ */
+void test_generator(void) {
+	int sum = 0;
+	for (int i : count_to(5)) {
+		sum += i;
+	}
+	assert(sum == 0 + 1 + 2 + 3 + 4);
+
+	for (int i : count_to(0)) {
+		assert(i < 0);
+	}
+
+	// Stages are generators that consume other generators
+	vector<int> evens;
+	for (int i : filter_stage(count_to(10), [](int i) { return i % 2 == 0; })) {
+		evens.push_back(i);
+	}
+	assert((evens == vector<int> { 0, 2, 4, 6, 8 }));
+
+	int squares = 0;
+	for (int i : map_stage(count_to(4), [](int i) { return i * i; })) {
+		squares += i;
+	}
+	assert(squares == 0 + 1 + 4 + 9);
+}
+
+/**
+ * Tests splitting a file in lines with a buffer much smaller than the file,
+ * so that lines cross the end of the buffer and some do not fit in it.
+ */
+void test_split_lines(void) {
+	const char* text = "Hello\n\nWorld!\na line longer than the buffer\nend";
+	FILE* file = text_file(text);
+	vector<string> lines;
+	for (string_view line : split_lines(file, 4)) {
+		lines.emplace_back(line);
+	}
+	fclose(file);
+	assert((lines == vector<string> { "Hello", "", "World!",
+			"a line longer than the buffer", "end" }));
+
+	// A final line break does not add an empty line
+	file = text_file("a\nb\n");
+	int count = 0;
+	for (string_view line : split_lines(file, 2)) {
+		assert(line.size() == 1);
+		count++;
+	}
+	fclose(file);
+	assert(count == 2);
+}
+
+/**
+ * Tests a pipeline of stages that counts the characters of words that start
+ * with an uppercase letter.
+ */
+void test_pipeline(void) {
+	FILE* file = text_file("The quick  brown\nFox jumps over\n\nthe Lazy dog\n");
+	auto words = tokenize(split_lines(file, 8));
+	auto capitalized = filter_stage(std::move(words), [](string_view word) {
+		return word[0] >= 'A' && word[0] <= 'Z';
+	});
+	size_t total = 0;
+	vector<size_t> lengths;
+	for (size_t length : map_stage(std::move(capitalized),
+			[](string_view word) { return word.size(); })) {
+		lengths.push_back(length);
+		total += length;
+	}
+	fclose(file);
+	assert((lengths == vector<size_t> { 3, 3, 4 }));
+	assert(total == 10);
+}
+
+void run_char_stream_tests(void) {
+	test_generator();
+	test_split_lines();
+	test_pipeline();
+}
+
+/**
+ * Returns the peak resident memory of the process in KB since the last
+ * call, or since the start if it can not be reset.
+ */
+static long peak_rss_kb(void) {
+	long peak = 0;
+	FILE* status = fopen("/proc/self/status", "r");
+	if (status) {
+		char line[256];
+		while (fgets(line, sizeof(line), status)) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				peak = atol(line + 6);
+			}
+		}
+		fclose(status);
+	}
+	// Writing 5 resets the peak on Linux
+	FILE* clear = fopen("/proc/self/clear_refs", "w");
+	if (clear) {
+		fputs("5", clear);
+		fclose(clear);
+	}
+	return peak;
+}
+
+/**
+ * Counts the words of a large file by streaming it through generators, and
+ * by loading it into a string and splitting that, printing the lines per
+ * second and the peak memory of each.
+ */
+void bench_line_count(void) {
+	const long lines = 4000000;
+	FILE* file = tmpfile();
+	for (long i = 0; i < lines; i++) {
+		fprintf(file, "line %ld of a file with several words\n", i);
+	}
+
+	rewind(file);
+	peak_rss_kb();
+	long words = 0;
+	double streaming = time_seconds([&] {
+		for (string_view word : tokenize(split_lines(file))) {
+			words += word.size() > 0;
+		}
+	});
+	long streaming_peak = peak_rss_kb();
+	print_rate("generator pipeline", lines, streaming, "lines");
+
+	rewind(file);
+	long loaded_words = 0;
+	double loading = time_seconds([&] {
+		string text;
+		char chunk[1 << 16];
+		size_t n;
+		while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+			text.append(chunk, n);
+		}
+		vector<string_view> split;
+		size_t start = 0;
+		size_t stop;
+		while ((stop = text.find('\n', start)) != string::npos) {
+			split.emplace_back(text.data() + start, stop - start);
+			start = stop + 1;
+		}
+		for (string_view line : split) {
+			size_t from = 0;
+			while (from < line.size()) {
+				size_t to = line.find(' ', from);
+				to = to == string_view::npos ? line.size() : to;
+				loaded_words += to > from;
+				from = to + 1;
+			}
+		}
+	});
+	long loading_peak = peak_rss_kb();
+	print_rate("load into string and split", lines, loading, "lines");
+	assert(words == loaded_words);
+	printf("%-40s %9ld KB vs %ld KB\n", "peak RSS, streaming vs loading",
+			streaming_peak, loading_peak);
+	fclose(file);
+}
+
+void run_char_stream_benchmarks(void) {
+	bench_line_count();
+}
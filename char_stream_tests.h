@@ -0,0 +1,7 @@
+#ifndef CHAR_STREAM_TESTS_H_
+#define CHAR_STREAM_TESTS_H_
+
+void run_char_stream_tests(void);
+void run_char_stream_benchmarks(void);
+
+#endif /* CHAR_STREAM_TESTS_H_ */
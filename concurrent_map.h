@@ -0,0 +1,366 @@
+#ifndef CONCURRENT_MAP_H_
+#define CONCURRENT_MAP_H_
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash map from int keys, such as the id of a 'MyStruct', to values, that
+ * can be read and written by many threads at once.
+ *
+ * The map is split in shards by the hash of the key, and each shard is an
+ * open addressing table with linear probing. Writers take the lock of their
+ * shard only, so writers of different shards do not wait for each other.
+ *
+ * Readers never lock. Each shard has a sequence number that a writer makes
+ * odd while it changes the shard and even again when done. A reader reads
+ * the number, looks the key up, and reads the number again; if it changed,
+ * a writer interfered and the reader tries again. To make these racy reads
+ * well defined, slots are read and written as relaxed atomic words, which
+ * is why values must be trivially copyable.
+ *
+ * The two smallest ints mark empty and deleted slots, so they can not be
+ * keys: they are never found, and inserting them throws.
+ *
+ * A shard grows on its own when it is too full, so resizing never stops the
+ * other shards. A reader may still be probing the old table, so old tables
+ * are only freed with the map. Since tables only ever double, they take at
+ * most as much memory as the current ones. Deleted keys are dropped within
+ * the current table, so erasing and inserting keys allocates no tables.
+ */
+template<class V>
+class ConcurrentMap {
+	static_assert(std::is_trivially_copyable<V>::value,
+			"values are copied word by word");
+
+	static constexpr int empty_key = INT_MIN;
+	static constexpr int deleted_key = INT_MIN + 1;
+	static constexpr size_t value_words = (sizeof(V) + 7) / 8;
+
+	static bool is_reserved(int key) {
+		return key == empty_key || key == deleted_key;
+	}
+
+	struct Table {
+		size_t mask;
+		std::unique_ptr<std::atomic<int>[]> keys;
+		std::unique_ptr<std::atomic<uint64_t>[]> values;
+
+		Table(size_t capacity) :
+				mask(capacity - 1), keys(new std::atomic<int>[capacity]), values(
+						new std::atomic<uint64_t>[capacity * value_words]) {
+			for (size_t i = 0; i < capacity; i++) {
+				keys[i].store(empty_key, std::memory_order_relaxed);
+			}
+		}
+
+		void load(size_t slot, V& value) const {
+			uint64_t words[value_words];
+			for (size_t w = 0; w < value_words; w++) {
+				words[w] = values[slot * value_words + w].load(
+						std::memory_order_relaxed);
+			}
+			memcpy(&value, words, sizeof(V));
+		}
+
+		void store(size_t slot, const V& value) {
+			uint64_t words[value_words] = { };
+			memcpy(words, &value, sizeof(V));
+			for (size_t w = 0; w < value_words; w++) {
+				values[slot * value_words + w].store(words[w],
+						std::memory_order_relaxed);
+			}
+		}
+	};
+
+	struct alignas(64) Shard {
+		std::atomic<unsigned> sequence { 0 };
+		std::atomic<Table*> table { nullptr };
+		std::mutex lock;
+		// Live keys, and live plus deleted keys, in the current table
+		size_t size = 0;
+		size_t used = 0;
+		// The current table and every table it replaced
+		std::vector<std::unique_ptr<Table>> tables;
+	};
+
+	std::unique_ptr<Shard[]> shards;
+	size_t shard_mask;
+
+	static uint32_t hash(int key) {
+		uint32_t h = (uint32_t) key;
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+
+	Shard& shard_of(uint32_t h) const {
+		// The low bits pick the slot, so the shard is picked by the high bits
+		return shards[(h >> 24) & shard_mask];
+	}
+
+	/**
+	 * Marks the start of a change to a shard, while holding its lock.
+	 */
+	static void begin_write(Shard& shard) {
+		shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	static void end_write(Shard& shard) {
+		shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1,
+				std::memory_order_release);
+	}
+
+	/**
+	 * Stores a key that is not in the table in the first empty slot of its
+	 * probe sequence.
+	 */
+	static void place(Table& table, int key, const V& value) {
+		size_t slot = hash(key) & table.mask;
+		while (table.keys[slot].load(std::memory_order_relaxed) != empty_key) {
+			slot = (slot + 1) & table.mask;
+		}
+		table.store(slot, value);
+		table.keys[slot].store(key, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Drops the deleted keys of the table of a shard by placing its live
+	 * keys again within the same table. Readers try again until it is done,
+	 * and always find an empty slot meanwhile, since the table is never
+	 * fuller than before.
+	 */
+	static void drop_deleted(Shard& shard) {
+		Table* table = shard.table.load(std::memory_order_relaxed);
+		std::vector<std::pair<int, V>> live;
+		live.reserve(shard.size);
+		for (size_t i = 0; i <= table->mask; i++) {
+			int key = table->keys[i].load(std::memory_order_relaxed);
+			if (key != empty_key && key != deleted_key) {
+				V value;
+				table->load(i, value);
+				live.push_back( { key, value });
+			}
+		}
+
+		begin_write(shard);
+		for (size_t i = 0; i <= table->mask; i++) {
+			table->keys[i].store(empty_key, std::memory_order_relaxed);
+		}
+		for (const auto& [key, value] : live) {
+			place(*table, key, value);
+		}
+		end_write(shard);
+		shard.used = shard.size;
+	}
+
+	/**
+	 * Replaces the table of a shard with one of twice its capacity holding
+	 * its live keys, dropping the deleted ones.
+	 */
+	static void grow(Shard& shard) {
+		Table* old = shard.table.load(std::memory_order_relaxed);
+		std::unique_ptr<Table> table(new Table((old->mask + 1) * 2));
+		for (size_t i = 0; i <= old->mask; i++) {
+			int key = old->keys[i].load(std::memory_order_relaxed);
+			if (key == empty_key || key == deleted_key) {
+				continue;
+			}
+			V value;
+			old->load(i, value);
+			place(*table, key, value);
+		}
+
+		// Released, so a reader that loads the table sees it complete
+		begin_write(shard);
+		shard.table.store(table.get(), std::memory_order_release);
+		end_write(shard);
+		shard.tables.push_back(std::move(table));
+		shard.used = shard.size;
+	}
+public:
+	/**
+	 * Creates a map with the given number of shards, rounded up to a power
+	 * of two.
+	 */
+	explicit ConcurrentMap(size_t shard_count = 64) {
+		size_t n = 1;
+		while (n < shard_count) {
+			n *= 2;
+		}
+		shards.reset(new Shard[n]);
+		shard_mask = n - 1;
+		for (size_t i = 0; i < n; i++) {
+			shards[i].tables.emplace_back(new Table(16));
+			shards[i].table.store(shards[i].tables.back().get(),
+					std::memory_order_release);
+		}
+	}
+
+	/**
+	 * Looks the key up, copying its value into value if it is found.
+	 */
+	bool find(int key, V& value) const {
+		if (is_reserved(key)) {
+			return false;
+		}
+		uint32_t h = hash(key);
+		Shard& shard = shard_of(h);
+		for (;;) {
+			unsigned before = shard.sequence.load(std::memory_order_acquire);
+			if (before & 1) {
+				continue;
+			}
+			const Table* table = shard.table.load(std::memory_order_acquire);
+			bool found = false;
+			for (size_t slot = h & table->mask;; slot = (slot + 1) & table->mask) {
+				int k = table->keys[slot].load(std::memory_order_relaxed);
+				if (k == key) {
+					table->load(slot, value);
+					found = true;
+					break;
+				}
+				if (k == empty_key) {
+					break;
+				}
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (shard.sequence.load(std::memory_order_relaxed) == before) {
+				return found;
+			}
+		}
+	}
+
+	/**
+	 * Sets the value of the key, returning true if the key is new. Throws
+	 * 'std::invalid_argument' if the key is one of the two smallest ints.
+	 */
+	bool insert_or_assign(int key, const V& value) {
+		if (is_reserved(key)) {
+			throw std::invalid_argument("reserved ConcurrentMap key");
+		}
+		uint32_t h = hash(key);
+		Shard& shard = shard_of(h);
+		std::lock_guard<std::mutex> lock(shard.lock);
+
+		Table* table = shard.table.load(std::memory_order_relaxed);
+		size_t slot = h & table->mask;
+		size_t free = SIZE_MAX;
+		for (;; slot = (slot + 1) & table->mask) {
+			int k = table->keys[slot].load(std::memory_order_relaxed);
+			if (k == key) {
+				begin_write(shard);
+				table->store(slot, value);
+				end_write(shard);
+				return false;
+			}
+			if (k == deleted_key && free == SIZE_MAX) {
+				free = slot;
+			}
+			if (k == empty_key) {
+				break;
+			}
+		}
+
+		// Keeps the table at most 3/4 full, counting deleted keys, so
+		// probes always end at an empty slot
+		if (free == SIZE_MAX && (shard.used + 1) * 4 > (table->mask + 1) * 3) {
+			if (shard.size * 2 >= table->mask + 1) {
+				grow(shard);
+			} else {
+				drop_deleted(shard);
+			}
+			table = shard.table.load(std::memory_order_relaxed);
+			for (slot = h & table->mask;
+					table->keys[slot].load(std::memory_order_relaxed)
+							!= empty_key; slot = (slot + 1) & table->mask) {
+			}
+		} else if (free != SIZE_MAX) {
+			slot = free;
+		}
+		if (table->keys[slot].load(std::memory_order_relaxed) == empty_key) {
+			shard.used++;
+		}
+		shard.size++;
+
+		begin_write(shard);
+		table->store(slot, value);
+		table->keys[slot].store(key, std::memory_order_relaxed);
+		end_write(shard);
+		return true;
+	}
+
+	/**
+	 * Removes the key, returning true if it was in the map.
+	 */
+	bool erase(int key) {
+		if (is_reserved(key)) {
+			return false;
+		}
+		uint32_t h = hash(key);
+		Shard& shard = shard_of(h);
+		std::lock_guard<std::mutex> lock(shard.lock);
+
+		Table* table = shard.table.load(std::memory_order_relaxed);
+		for (size_t slot = h & table->mask;; slot = (slot + 1) & table->mask) {
+			int k = table->keys[slot].load(std::memory_order_relaxed);
+			if (k == key) {
+				// Marked deleted rather than empty, so that probes for keys
+				// further along do not stop here
+				begin_write(shard);
+				table->keys[slot].store(deleted_key, std::memory_order_relaxed);
+				end_write(shard);
+				shard.size--;
+				return true;
+			}
+			if (k == empty_key) {
+				return false;
+			}
+		}
+	}
+
+	/**
+	 * Returns the bytes taken by the tables of every shard, including the
+	 * tables they replaced.
+	 */
+	size_t reserved_bytes() const {
+		size_t bytes = 0;
+		for (size_t i = 0; i <= shard_mask; i++) {
+			std::lock_guard<std::mutex> lock(shards[i].lock);
+			for (const auto& table : shards[i].tables) {
+				bytes += (table->mask + 1)
+						* (sizeof(std::atomic<int>)
+								+ value_words * sizeof(std::atomic<uint64_t>));
+			}
+		}
+		return bytes;
+	}
+
+	/**
+	 * Returns the number of keys in the map. While other threads write to
+	 * the map, this is only an estimate.
+	 */
+	size_t size() const {
+		size_t n = 0;
+		for (size_t i = 0; i <= shard_mask; i++) {
+			std::lock_guard<std::mutex> lock(shards[i].lock);
+			n += shards[i].size;
+		}
+		return n;
+	}
+};
+
+#endif /* CONCURRENT_MAP_H_ */
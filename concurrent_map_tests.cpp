@@ -0,0 +1,261 @@
+#include <cassert>
+#include <climits>
+#include <random>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "benchmark.h"
+#include "concurrent_map.h"
+#include "concurrent_map_tests.h"
+#include "unions.h"
+
+using namespace std;
+
+/**
+ * Tests looking records up by their id from a single thread.
+ */
+void test_concurrent_map(void) {
+	ConcurrentMap<MyStruct> map(4);
+	MyStruct s;
+	s.id = 7;
+	s.l = 70;
+
+	assert(!map.find(7, s));
+	assert(map.insert_or_assign(s.id, s));
+	assert(map.size() == 1);
+
+	MyStruct found;
+	assert(map.find(7, found));
+	assert(found.id == 7 && found.l == 70);
+
+	// Assigning an existing key replaces its value
+	s.l = 71;
+	assert(!map.insert_or_assign(s.id, s));
+	assert(map.find(7, found) && found.l == 71);
+	assert(map.size() == 1);
+
+	assert(map.erase(7));
+	assert(!map.erase(7));
+	assert(!map.find(7, found));
+	assert(map.size() == 0);
+
+	// Grows well past the initial tables, with and without deleted keys
+	for (int id = -50000; id < 50000; id++) {
+		s.id = id;
+		s.l = id * 10L;
+		assert(map.insert_or_assign(id, s));
+	}
+	for (int id = -50000; id < 50000; id += 2) {
+		assert(map.erase(id));
+	}
+	assert(map.size() == 50000);
+	for (int id = -50000; id < 50000; id++) {
+		bool present = map.find(id, found);
+		assert(present == (id % 2 != 0));
+		assert(!present || (found.id == id && found.l == id * 10L));
+	}
+}
+
+/**
+ * Tests that the keys marking empty and deleted slots are never found,
+ * erased or inserted, even when the map has both kinds of slots.
+ */
+void test_concurrent_map_reserved_keys(void) {
+	ConcurrentMap<MyStruct> map(1);
+	MyStruct s;
+	for (int id = 0; id < 10; id++) {
+		s.id = id;
+		map.insert_or_assign(id, s);
+	}
+	map.erase(0);
+
+	for (int key : { INT_MIN, INT_MIN + 1 }) {
+		MyStruct found;
+		assert(!map.find(key, found));
+		for (int i = 0; i < 100; i++) {
+			assert(!map.erase(key));
+		}
+		bool thrown = false;
+		try {
+			map.insert_or_assign(key, s);
+		} catch (const invalid_argument&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	assert(map.size() == 9);
+	for (int id = 1; id < 10; id++) {
+		MyStruct found;
+		assert(map.find(id, found) && found.id == id);
+	}
+}
+
+/**
+ * Tests that erasing and inserting keys, with the number of keys staying
+ * the same, drops deleted keys without taking more memory.
+ */
+void test_concurrent_map_churn(void) {
+	ConcurrentMap<MyStruct> map(4);
+	MyStruct s;
+	for (int id = 0; id < 1000; id++) {
+		s.id = id;
+		map.insert_or_assign(id, s);
+	}
+	// A shard that holds more than half its capacity grows once, and then
+	// the memory must stay the same however long the churn goes on
+	size_t reserved = 0;
+	for (int id = 1000; id < 1000000; id++) {
+		s.id = id;
+		assert(map.erase(id - 1000));
+		assert(map.insert_or_assign(id, s));
+		if (id == 100000) {
+			reserved = map.reserved_bytes();
+		}
+	}
+	assert(map.size() == 1000);
+	assert(map.reserved_bytes() == reserved);
+	MyStruct found;
+	for (int id = 999000; id < 1000000; id++) {
+		assert(map.find(id, found) && found.id == id);
+	}
+}
+
+/**
+ * Tests readers racing with writers that insert, update and erase keys
+ * and make shards grow. A reader must never see a half written record.
+ */
+void test_concurrent_map_threads(void) {
+	ConcurrentMap<MyStruct> map(8);
+	const int keys = 20000;
+	atomic<bool> done(false);
+
+	vector<thread> threads;
+	for (int w = 0; w < 2; w++) {
+		threads.emplace_back([&, w] {
+			MyStruct s;
+			for (int round = 0; round < 5; round++) {
+				for (int id = w; id < keys; id += 2) {
+					s.id = id;
+					s.l = (long) id * 1000 + round;
+					map.insert_or_assign(id, s);
+				}
+				for (int id = w; id < keys; id += 6) {
+					map.erase(id);
+				}
+			}
+		});
+	}
+	for (int r = 0; r < 2; r++) {
+		threads.emplace_back([&, r] {
+			mt19937 random(r);
+			MyStruct s;
+			while (!done.load()) {
+				int id = random() % keys;
+				if (map.find(id, s)) {
+					assert(s.id == id);
+					assert(s.l / 1000 == id);
+				}
+			}
+		});
+	}
+	for (int w = 0; w < 2; w++) {
+		threads[w].join();
+	}
+	done = true;
+	for (size_t t = 2; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	assert(map.size() == keys - (keys + 5) / 6 - (keys + 4) / 6);
+}
+
+void run_concurrent_map_tests(void) {
+	test_concurrent_map();
+	test_concurrent_map_reserved_keys();
+	test_concurrent_map_churn();
+	test_concurrent_map_threads();
+}
+
+/**
+ * A standard map behind a reader-writer lock, the usual way of sharing one.
+ */
+class LockedMap {
+	unordered_map<int, MyStruct> map;
+	mutable shared_mutex lock;
+public:
+	bool find(int key, MyStruct& value) const {
+		shared_lock<shared_mutex> guard(lock);
+		auto it = map.find(key);
+		if (it == map.end()) {
+			return false;
+		}
+		value = it->second;
+		return true;
+	}
+
+	bool insert_or_assign(int key, const MyStruct& value) {
+		unique_lock<shared_mutex> guard(lock);
+		return map.insert_or_assign(key, value).second;
+	}
+};
+
+/**
+ * Runs a mix of reads and writes of random keys from several threads and
+ * prints the operations per second.
+ */
+template<class Map>
+void bench_mix(const char* name, int threads, int write_percent) {
+	const int keys = 1 << 20;
+	const long ops = 2000000;
+	Map map;
+	MyStruct s;
+	for (int id = 0; id < keys; id++) {
+		s.id = id;
+		s.l = id;
+		map.insert_or_assign(id, s);
+	}
+
+	double seconds = time_seconds([&] {
+		vector<thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&, t] {
+				mt19937 random(t);
+				MyStruct value;
+				long found = 0;
+				for (long i = 0; i < ops / threads; i++) {
+					int id = random() % keys;
+					if ((int) (random() % 100) < write_percent) {
+						value.id = id;
+						value.l = i;
+						map.insert_or_assign(id, value);
+					} else {
+						found += map.find(id, value);
+					}
+				}
+				do_not_optimize(found);
+			});
+		}
+		for (thread& w : workers) {
+			w.join();
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s %d%% writes, %d threads", name,
+			write_percent, threads);
+	print_rate(label, ops, seconds, "ops");
+}
+
+void run_concurrent_map_benchmarks(void) {
+	int n = thread::hardware_concurrency();
+	const int mixes[] = { 5, 50 };
+	for (int write_percent : mixes) {
+		// Doubles the threads up to all cores, whether n is a power of 2 or not
+		for (int threads = 1; threads <= n;
+				threads = threads < n && threads * 2 > n ? n : threads * 2) {
+			bench_mix<LockedMap>("locked unordered_map", threads, write_percent);
+			bench_mix<ConcurrentMap<MyStruct>>("ConcurrentMap", threads,
+					write_percent);
+		}
+	}
+}
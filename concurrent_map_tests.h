@@ -0,0 +1,7 @@
+#ifndef CONCURRENT_MAP_TESTS_H_
+#define CONCURRENT_MAP_TESTS_H_
+
+void run_concurrent_map_tests(void);
+void run_concurrent_map_benchmarks(void);
+
+#endif /* CONCURRENT_MAP_TESTS_H_ */
@@ -0,0 +1,17 @@
+#ifndef DATA_STRUCTURES_H_
+#define DATA_STRUCTURES_H_
+
+#include "pool_alloc.h"
+
+/**
+ * A person.
+ *
+ * Persons are small and often short lived, so they are allocated from a
+ * per thread pool rather than by the general purpose allocator.
+ */
+struct Person: PoolAllocated<Person> {
+	int age;
+	double height;
+};
+
+#endif /* DATA_STRUCTURES_H_ */
@@ -1,13 +1,11 @@
 #include <string>
+#include <vector>
 #include <cassert>
+#include <thread>
+#include "data_structures.h"
 
 using namespace std;
 
-struct Person {
-	int age;
-	double height;
-};
-
 struct Color {
 	int red;
 	int green;
@@ -50,7 +48,45 @@ void test_struct_pointer(void) {
 	assert(john->age == 20);
 	assert(john->height == 1.80);
 
-	free(john);
+	// An object created with 'new' must be destroyed with 'delete', not
+	// 'free'. Here 'delete' also returns the memory to the pool of Person.
+	delete john;
+}
+
+/**
+ * Tests allocating data structures from a pool.
+ *
+ * Since a Person defines its own 'new' and 'delete', it is allocated in a
+ * slot of a slab of its pool. A freed slot is reused by the next 'new'.
+ */
+void test_struct_pool(void) {
+	Person* a = new Person;
+	delete a;
+	Person* b = new Person;
+	assert(a == b);
+
+	// Persons allocated one after the other are next to each other
+	Person* c = new Person;
+	assert(c == b - 1 || c == b + 1);
+
+	// A Person deleted by another thread goes back to the pool of this
+	// thread, which reuses it once its own free slots run out
+	thread t([c] {
+		delete c;
+	});
+	t.join();
+
+	vector<Person*> persons;
+	bool reused = false;
+	while (!reused) {
+		Person* p = new Person;
+		reused = p == c;
+		persons.push_back(p);
+	}
+	for (Person* p : persons) {
+		delete p;
+	}
+	delete b;
 }
 
 void test_nested_structure(void) {
@@ -66,5 +102,6 @@ void test_nested_structure(void) {
 void run_data_structures_tests(void) {
 	test_struct();
 	test_struct_pointer();
+	test_struct_pool();
 	test_nested_structure();
 }
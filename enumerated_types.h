@@ -0,0 +1,19 @@
+#ifndef ENUMERATED_TYPES_H_
+#define ENUMERATED_TYPES_H_
+
+enum class Month {
+	January,
+	February,
+	March,
+	April,
+	May,
+	June,
+	July,
+	August,
+	September,
+	October,
+	November,
+	December
+};
+
+#endif /* ENUMERATED_TYPES_H_ */
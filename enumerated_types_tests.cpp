@@ -1,4 +1,5 @@
 #include <cassert>
+#include "enumerated_types.h"
 
 enum RGB {
 	Red, Green, Blue
@@ -8,21 +9,6 @@ enum Weekday {
 	Monday = 1, Tuesday, Wednesday, Thursday, Friday, Saturday, Sunday
 };
 
-enum class Month {
-	January,
-	February,
-	March,
-	April,
-	May,
-	June,
-	July,
-	August,
-	September,
-	October,
-	November,
-	December
-};
-
 // It is possible to specify the size of an enumeration class type
 enum class Planet
 	: char {
@@ -0,0 +1,431 @@
+#ifndef FLAT_HASH_MAP_H_
+#define FLAT_HASH_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string_view>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Control byte of an empty slot.
+ */
+constexpr int8_t ctrl_empty = -128;
+
+/**
+ * Control byte of a slot whose element was erased (a tombstone).
+ */
+constexpr int8_t ctrl_deleted = -2;
+
+/**
+ * Sixteen consecutive control bytes, compared all at once.
+ *
+ * The control byte of a slot with an element holds 7 bits of the element's
+ * hash, so that most slots can be ruled out without looking at the element
+ * itself. Control bytes of slots without an element are negative.
+ */
+class Group {
+#ifdef __SSE2__
+	__m128i ctrl;
+public:
+	explicit Group(const int8_t* p) :
+			ctrl(_mm_load_si128((const __m128i*) p)) {
+	}
+
+	/**
+	 * Returns a mask with a bit set for every slot whose byte is h2.
+	 */
+	uint32_t match(int8_t h2) const {
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+	}
+
+	/**
+	 * Returns a mask with a bit set for every slot without an element.
+	 */
+	uint32_t match_empty_or_deleted() const {
+		return _mm_movemask_epi8(ctrl);
+	}
+#else
+	const int8_t* ctrl;
+public:
+	explicit Group(const int8_t* p) :
+			ctrl(p) {
+	}
+
+	uint32_t match(int8_t h2) const {
+		uint32_t mask = 0;
+		for (int i = 0; i < 16; i++) {
+			mask |= (uint32_t) (ctrl[i] == h2) << i;
+		}
+		return mask;
+	}
+
+	uint32_t match_empty_or_deleted() const {
+		uint32_t mask = 0;
+		for (int i = 0; i < 16; i++) {
+			mask |= (uint32_t) (ctrl[i] < 0) << i;
+		}
+		return mask;
+	}
+#endif
+
+	uint32_t match_empty() const {
+		return match(ctrl_empty);
+	}
+
+	static constexpr size_t width = 16;
+};
+
+/**
+ * Hash of strings that also accepts c-strings and string views, so that a
+ * map keyed by 'std::string' can be searched without creating one.
+ */
+struct StringHash {
+	using is_transparent = void;
+
+	size_t operator()(std::string_view s) const {
+		return std::hash<std::string_view>()(s);
+	}
+};
+
+/**
+ * Equality of strings, c-strings and string views by their characters.
+ */
+struct StringEqual {
+	using is_transparent = void;
+
+	bool operator()(std::string_view a, std::string_view b) const {
+		return a == b;
+	}
+};
+
+/**
+ * Value of the elements of a set, which takes no space.
+ */
+struct NoValue {
+};
+
+/**
+ * Hash map that stores its elements in one flat array of slots.
+ *
+ * Slots are split in groups of 16, each with 16 control bytes that are
+ * compared with a single SIMD instruction. Lookup starts at the group given
+ * by the hash of the key and, if the key is not there, goes on to other
+ * groups until one that has an empty slot, so a lookup seldom looks at more
+ * than one group and no pointer is followed.
+ *
+ * Erased elements leave tombstones, so that lookups of keys further along
+ * do not stop early. When tombstones take too much room, the table is
+ * rehashed in place, without allocating.
+ *
+ * If Hash and Eq are transparent, such as 'StringHash' and 'StringEqual',
+ * keys can be looked up by any type they accept.
+ */
+template<class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+class FlatHashMap {
+public:
+	struct Slot {
+		K key;
+		[[no_unique_address]] V value;
+	};
+private:
+	int8_t* ctrl;
+	Slot* slots;
+	size_t group_mask;
+	size_t capacity;
+	size_t count;
+	size_t deleted;
+	Hash hasher;
+	Eq equal;
+
+	static const int8_t* empty_group() {
+		alignas(16) static const int8_t group[Group::width] = { ctrl_empty,
+				ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+				ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+				ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty };
+		return group;
+	}
+
+	template<class Q>
+	uint64_t hash(const Q& key) const {
+		// Mixes the hash, since std::hash of an integer is the integer
+		__uint128_t m = (__uint128_t) hasher(key) * 0x9e3779b97f4a7c15ull;
+		return (uint64_t) m ^ (uint64_t) (m >> 64);
+	}
+
+	static int8_t h2(uint64_t h) {
+		return h & 0x7f;
+	}
+
+	/**
+	 * Returns the index of the slot of the key, or capacity if it is absent.
+	 */
+	template<class Q>
+	size_t find_index(const Q& key) const {
+		uint64_t h = hash(key);
+		size_t g = (h >> 7) & group_mask;
+		for (size_t step = 1;; step++) {
+			Group group(ctrl + g * Group::width);
+			for (uint32_t m = group.match(h2(h)); m; m &= m - 1) {
+				size_t i = g * Group::width + __builtin_ctz(m);
+				if (equal(slots[i].key, key)) {
+					return i;
+				}
+			}
+			if (group.match_empty()) {
+				return capacity;
+			}
+			// Triangular steps visit every group once
+			g = (g + step) & group_mask;
+		}
+	}
+
+	/**
+	 * Returns the index of the first slot without an element along the
+	 * probe sequence of the given hash.
+	 */
+	size_t find_free(uint64_t h) const {
+		size_t g = (h >> 7) & group_mask;
+		for (size_t step = 1;; step++) {
+			uint32_t m = Group(ctrl + g * Group::width).match_empty_or_deleted();
+			if (m) {
+				return g * Group::width + __builtin_ctz(m);
+			}
+			g = (g + step) & group_mask;
+		}
+	}
+
+	void allocate(size_t new_capacity) {
+		capacity = new_capacity;
+		group_mask = capacity / Group::width - 1;
+		ctrl = (int8_t*) ::operator new(capacity, std::align_val_t(16));
+		memset(ctrl, ctrl_empty, capacity);
+		slots = (Slot*) ::operator new(capacity * sizeof(Slot),
+				std::align_val_t(alignof(Slot)));
+		deleted = 0;
+	}
+
+	void deallocate(int8_t* old_ctrl, Slot* old_slots) {
+		if (old_ctrl != empty_group()) {
+			::operator delete(old_ctrl, std::align_val_t(16));
+			::operator delete(old_slots, std::align_val_t(alignof(Slot)));
+		}
+	}
+
+	void move_slot(size_t from, size_t to) {
+		new (&slots[to]) Slot(std::move(slots[from]));
+		slots[from].~Slot();
+	}
+
+	/**
+	 * Moves all elements to a new array of twice the capacity.
+	 */
+	void grow() {
+		int8_t* old_ctrl = ctrl;
+		Slot* old_slots = slots;
+		size_t old_capacity = capacity;
+		allocate(capacity ? capacity * 2 : Group::width);
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] >= 0) {
+				uint64_t h = hash(old_slots[i].key);
+				size_t j = find_free(h);
+				ctrl[j] = h2(h);
+				new (&slots[j]) Slot(std::move(old_slots[i]));
+				old_slots[i].~Slot();
+			}
+		}
+		deallocate(old_ctrl, old_slots);
+	}
+
+	/**
+	 * Drops all tombstones by moving elements to where they would be in a
+	 * table without them, within the same array.
+	 *
+	 * First every tombstone is made empty and every element is marked
+	 * deleted, meaning not placed yet. Then each unplaced element is either
+	 * left where it is, if that is already the first free group of its probe
+	 * sequence, moved to an empty slot, or swapped with an unplaced element,
+	 * which is then placed in turn.
+	 */
+	void rehash_in_place() {
+		for (size_t i = 0; i < capacity; i++) {
+			ctrl[i] = ctrl[i] == ctrl_deleted || ctrl[i] == ctrl_empty ?
+					ctrl_empty : ctrl_deleted;
+		}
+		for (size_t i = 0; i < capacity; i++) {
+			if (ctrl[i] != ctrl_deleted) {
+				continue;
+			}
+			uint64_t h = hash(slots[i].key);
+			size_t j = find_free(h);
+			if (j / Group::width == i / Group::width) {
+				ctrl[i] = h2(h);
+			} else if (ctrl[j] == ctrl_empty) {
+				ctrl[j] = h2(h);
+				move_slot(i, j);
+				ctrl[i] = ctrl_empty;
+			} else {
+				ctrl[j] = h2(h);
+				std::swap(slots[i], slots[j]);
+				i--;
+			}
+		}
+		deleted = 0;
+	}
+
+	/**
+	 * Makes room for one more element in an empty slot.
+	 */
+	void reserve_one() {
+		if ((count + deleted + 1) * 8 <= capacity * 7) {
+			return;
+		}
+		// If at least half the used slots are tombstones, dropping them is
+		// enough and growing would waste memory
+		if (deleted > 0 && count * 16 <= capacity * 7) {
+			rehash_in_place();
+		} else {
+			grow();
+		}
+	}
+public:
+	FlatHashMap() :
+			ctrl((int8_t*) empty_group()), slots(nullptr), group_mask(0), capacity(
+					0), count(0), deleted(0) {
+	}
+
+	FlatHashMap(const FlatHashMap&) = delete;
+	FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+	~FlatHashMap() {
+		for (size_t i = 0; i < capacity; i++) {
+			if (ctrl[i] >= 0) {
+				slots[i].~Slot();
+			}
+		}
+		deallocate(ctrl, slots);
+	}
+
+	/**
+	 * Returns the value of the key, or null if the key is absent.
+	 */
+	template<class Q>
+	V* find(const Q& key) {
+		size_t i = find_index(key);
+		return i == capacity ? nullptr : &slots[i].value;
+	}
+
+	template<class Q>
+	bool contains(const Q& key) const {
+		return find_index(key) != capacity;
+	}
+
+	/**
+	 * Inserts the key with the given value, unless the key is present.
+	 * Returns the value of the key and whether it was inserted.
+	 */
+	std::pair<V*, bool> insert(const K& key, V value = V()) {
+		size_t i = find_index(key);
+		if (i != capacity) {
+			return {&slots[i].value, false};
+		}
+		uint64_t h = hash(key);
+		i = find_free(h);
+		if (ctrl[i] == ctrl_deleted) {
+			deleted--;
+		} else {
+			reserve_one();
+			i = find_free(h);
+		}
+		new (&slots[i]) Slot { key, std::move(value) };
+		ctrl[i] = h2(h);
+		count++;
+		return {&slots[i].value, true};
+	}
+
+	V& operator[](const K& key) {
+		return *insert(key).first;
+	}
+
+	/**
+	 * Erases the key, returning whether it was present.
+	 */
+	template<class Q>
+	bool erase(const Q& key) {
+		size_t i = find_index(key);
+		if (i == capacity) {
+			return false;
+		}
+		slots[i].~Slot();
+		count--;
+		// A group that has an empty slot never made a lookup go on to the
+		// next group, so no tombstone is needed
+		if (Group(ctrl + i / Group::width * Group::width).match_empty()) {
+			ctrl[i] = ctrl_empty;
+		} else {
+			ctrl[i] = ctrl_deleted;
+			deleted++;
+		}
+		return true;
+	}
+
+	/**
+	 * Calls func with the key and value of every element.
+	 */
+	template<class F>
+	void for_each(F func) {
+		for (size_t i = 0; i < capacity; i++) {
+			if (ctrl[i] >= 0) {
+				func(slots[i].key, slots[i].value);
+			}
+		}
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	size_t tombstones() const {
+		return deleted;
+	}
+
+	size_t slot_count() const {
+		return capacity;
+	}
+};
+
+/**
+ * Hash set that stores its elements in one flat array, like 'FlatHashMap'.
+ */
+template<class K, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+class FlatHashSet {
+	FlatHashMap<K, NoValue, Hash, Eq> map;
+public:
+	/**
+	 * Inserts the key, returning whether it was absent.
+	 */
+	bool insert(const K& key) {
+		return map.insert(key).second;
+	}
+
+	template<class Q>
+	bool contains(const Q& key) const {
+		return map.contains(key);
+	}
+
+	template<class Q>
+	bool erase(const Q& key) {
+		return map.erase(key);
+	}
+
+	size_t size() const {
+		return map.size();
+	}
+};
+
+#endif /* FLAT_HASH_MAP_H_ */
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <random>
+#include <string_view>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "benchmark.h"
+#include "flat_hash_map.h"
+#include "flat_hash_map_tests.h"
+#include "type_aliases.h"
+
+using namespace std;
+
+/**
+ * Tests inserting, finding and erasing integer keys.
+ */
+void test_flat_hash_map(void) {
+	FlatHashMap<long, long> map;
+	assert(map.size() == 0);
+	assert(!map.find(1));
+
+	assert(map.insert(1, 10).second);
+	assert(!map.insert(1, 11).second);
+	assert(*map.find(1) == 10);
+	map[2] = 20;
+	assert(map[2] == 20);
+	assert(map.size() == 2);
+
+	assert(map.erase(1));
+	assert(!map.erase(1));
+	assert(!map.find(1));
+	assert(map.size() == 1);
+
+	// Grows through many capacities and checks against a standard map
+	unordered_map<long, long> expected = { { 2, 20 } };
+	mt19937_64 random(3);
+	for (int i = 0; i < 200000; i++) {
+		long key = random() % 50000;
+		switch (random() % 3) {
+		case 0:
+			assert(map.insert(key, i).second == expected.emplace(key, i).second);
+			break;
+		case 1:
+			assert(map.erase(key) == (expected.erase(key) == 1));
+			break;
+		default:
+			long* value = map.find(key);
+			auto it = expected.find(key);
+			assert((value != nullptr) == (it != expected.end()));
+			assert(!value || *value == it->second);
+		}
+	}
+	assert(map.size() == expected.size());
+	size_t visited = 0;
+	map.for_each([&](long key, long value) {
+		assert(expected.at(key) == value);
+		visited++;
+	});
+	assert(visited == expected.size());
+}
+
+/**
+ * Tests that tombstones are dropped by rehashing in place instead of
+ * growing the table, once few of the used slots hold elements.
+ */
+void test_flat_hash_map_tombstones(void) {
+	FlatHashMap<int, int> map;
+	// Fills the table up to its load limit, so most groups are full
+	deque<int> live;
+	int next = 0;
+	for (; next < 1792; next++) {
+		map.insert(next, next);
+		live.push_back(next);
+	}
+	size_t slots = map.slot_count();
+	assert(slots == 2048);
+
+	// Erases keys, keeping only the erases that leave tombstones, down to
+	// a low load, then inserts new keys until the tombstones and elements
+	// fill the table
+	bool rehashed = false;
+	for (int i = 0; i < 100000 && !rehashed; i++) {
+		if (map.size() > 880) {
+			int key = live.front();
+			live.pop_front();
+			size_t before = map.tombstones();
+			assert(map.erase(key));
+			if (map.tombstones() == before) {
+				map.insert(key, key);
+				live.push_back(key);
+			}
+		} else {
+			size_t before = map.tombstones();
+			assert(map.insert(next, next).second);
+			live.push_back(next++);
+			rehashed = before > 1 && map.tombstones() == 0;
+		}
+		assert(map.slot_count() == slots);
+	}
+	assert(rehashed);
+	assert(map.size() == live.size());
+	for (int key : live) {
+		assert(*map.find(key) == key);
+	}
+	sort(live.begin(), live.end());
+	for (int key = 0; key < next; key++) {
+		assert(map.contains(key) == binary_search(live.begin(), live.end(), key));
+	}
+}
+
+/**
+ * Tests looking string keys up by c-strings and string views, without
+ * creating a string for each lookup.
+ */
+void test_flat_hash_map_strings(void) {
+	FlatHashMap<String, int, StringHash, StringEqual> map;
+	map.insert("Hello", 1);
+	map.insert(String("World"), 2);
+
+	CString hello = "Hello";
+	assert(*map.find(hello) == 1);
+	assert(*map.find(string_view("World!", 5)) == 2);
+	assert(!map.find("world"));
+	assert(map.erase(string_view("Hello")));
+	assert(!map.contains(hello));
+
+	// Keys can also be c-strings, compared by their characters
+	FlatHashSet<CString, StringHash, StringEqual> set;
+	char buffer[] = "Hello";
+	assert(set.insert("Hello"));
+	assert(!set.insert(buffer));
+	assert(set.contains(String("Hello")));
+	assert(set.size() == 1);
+}
+
+void run_flat_hash_map_tests(void) {
+	test_flat_hash_map();
+	test_flat_hash_map_tombstones();
+	test_flat_hash_map_strings();
+}
+
+/**
+ * Inserts n random keys, looks up keys that are present and keys that are
+ * not, and erases all keys, printing the rate of each.
+ */
+template<class Map>
+void bench_map(const char* name, size_t n) {
+	mt19937_64 random(n);
+	vector<long> keys(n);
+	for (long& key : keys) {
+		// Odd keys are present, even keys are missing
+		key = random() | 1;
+	}
+	// Lookups are counted and randomized separately of the insertion order
+	size_t lookups = max(n, (size_t) 1000000);
+	vector<long> probes(lookups);
+	for (long& probe : probes) {
+		probe = keys[random() % n];
+	}
+
+	Map* map = new Map;
+	char label[64];
+	double insert = time_seconds([&] {
+		for (long key : keys) {
+			(*map)[key] = key;
+		}
+	});
+	snprintf(label, sizeof(label), "%s %zu insert", name, n);
+	print_rate(label, n, insert, "ops");
+
+	double hit = time_seconds([&] {
+		long sum = 0;
+		for (long probe : probes) {
+			sum += map->find(probe) != map->end();
+		}
+		do_not_optimize(sum);
+	});
+	snprintf(label, sizeof(label), "%s %zu hit", name, n);
+	print_rate(label, lookups, hit, "ops");
+
+	double miss = time_seconds([&] {
+		long sum = 0;
+		for (long probe : probes) {
+			sum += map->find(probe - 1) != map->end();
+		}
+		do_not_optimize(sum);
+	});
+	snprintf(label, sizeof(label), "%s %zu miss", name, n);
+	print_rate(label, lookups, miss, "ops");
+
+	double erase = time_seconds([&] {
+		for (long key : keys) {
+			map->erase(key);
+		}
+	});
+	snprintf(label, sizeof(label), "%s %zu erase", name, n);
+	print_rate(label, n, erase, "ops");
+	delete map;
+}
+
+/**
+ * Gives a 'FlatHashMap' the end() of a standard map, so both can be
+ * benchmarked by the same code.
+ */
+struct BenchFlatMap: FlatHashMap<long, long> {
+	long* end() {
+		return nullptr;
+	}
+};
+
+void run_flat_hash_map_benchmarks(void) {
+	// A standard map of 100M longs takes about 5 GB, so the largest size is
+	// only run on hosts with plenty of memory
+	size_t memory = (size_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+	size_t max_n = memory >= (size_t) 16 << 30 ? 100000000 : 10000000;
+	for (size_t n = 1000; n <= max_n; n *= 10) {
+		bench_map<unordered_map<long, long>>("unordered_map", n);
+		bench_map<BenchFlatMap>("FlatHashMap", n);
+	}
+}
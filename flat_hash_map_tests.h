@@ -0,0 +1,7 @@
+#ifndef FLAT_HASH_MAP_TESTS_H_
+#define FLAT_HASH_MAP_TESTS_H_
+
+void run_flat_hash_map_tests(void);
+void run_flat_hash_map_benchmarks(void);
+
+#endif /* FLAT_HASH_MAP_TESTS_H_ */
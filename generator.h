@@ -0,0 +1,109 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+/**
+ * Lazy sequence of values produced by a coroutine.
+ *
+ * The coroutine runs only when the next value is asked for, and stops at
+ * each 'co_yield'. The yielded value is not copied: the generator points to
+ * it for as long as the coroutine is suspended, so a coroutine can yield a
+ * view into a buffer it reuses for the next value.
+ */
+template<class T>
+class Generator {
+public:
+	struct promise_type {
+		const T* value = nullptr;
+		std::exception_ptr error;
+
+		Generator get_return_object() {
+			return Generator(
+					std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() {
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always yield_value(const T& v) {
+			value = std::addressof(v);
+			return {};
+		}
+
+		void return_void() {
+		}
+
+		void unhandled_exception() {
+			error = std::current_exception();
+		}
+	};
+
+	using Handle = std::coroutine_handle<promise_type>;
+
+	class iterator {
+		Handle handle;
+	public:
+		explicit iterator(Handle handle) :
+				handle(handle) {
+		}
+
+		const T& operator*() const {
+			return *handle.promise().value;
+		}
+
+		iterator& operator++() {
+			handle.resume();
+			if (handle.done() && handle.promise().error) {
+				std::rethrow_exception(handle.promise().error);
+			}
+			return *this;
+		}
+
+		bool operator==(std::default_sentinel_t) const {
+			return handle.done();
+		}
+	};
+private:
+	Handle handle;
+
+	explicit Generator(Handle handle) :
+			handle(handle) {
+	}
+public:
+	Generator(Generator&& other) :
+			handle(std::exchange(other.handle, nullptr)) {
+	}
+
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+
+	~Generator() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	/**
+	 * Runs the coroutine up to its first value. A generator can only be
+	 * iterated once.
+	 */
+	iterator begin() {
+		return ++iterator(handle);
+	}
+
+	std::default_sentinel_t end() {
+		return {};
+	}
+};
+
+#endif /* GENERATOR_H_ */
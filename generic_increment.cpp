@@ -0,0 +1,24 @@
+#include "generic_increment.h"
+
+void generic_increment_n(void* data, ElemType type, size_t count) {
+	switch (type) {
+	case ElemType::Int8:
+		increment_kernel((int8_t*) data, count);
+		break;
+	case ElemType::Int16:
+		increment_kernel((int16_t*) data, count);
+		break;
+	case ElemType::Int32:
+		increment_kernel((int32_t*) data, count);
+		break;
+	case ElemType::Int64:
+		increment_kernel((int64_t*) data, count);
+		break;
+	case ElemType::Float:
+		increment_kernel((float*) data, count);
+		break;
+	case ElemType::Double:
+		increment_kernel((double*) data, count);
+		break;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef GENERIC_INCREMENT_H_
+#define GENERIC_INCREMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The type of the elements of an untyped buffer.
+ */
+enum class ElemType
+	: char {
+		Int8, Int16, Int32, Int64, Float, Double
+};
+
+/**
+ * Increments each of the count elements of the given buffer by one.
+ *
+ * The elements are taken in blocks of a fixed size, and then one at a time
+ * for the rest. At -O2 the compiler only vectorizes loops whose number of
+ * iterations is a known multiple of the vector width, which the loop over a
+ * block is.
+ */
+template<class T>
+void increment_kernel(T* __restrict data, size_t count) {
+	const size_t block = 64;
+	size_t i = 0;
+	for (; i + block <= count; i += block) {
+		for (size_t j = 0; j < block; j++) {
+			data[i + j] += 1;
+		}
+	}
+	for (; i < count; i++) {
+		data[i] += 1;
+	}
+}
+
+/**
+ * Increments count elements of the given type stored in data by one.
+ *
+ * Unlike a per-element 'void*' function, the type is checked only once per
+ * call and the work is then delegated to the kernel of that type.
+ */
+void generic_increment_n(void* data, ElemType type, size_t count);
+
+#endif /* GENERIC_INCREMENT_H_ */
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstring>
+#include "int_codec.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static constexpr size_t lanes = 4;
+static constexpr size_t per_lane = BitPackedArray::block_size / lanes;
+
+/**
+ * Returns the bits needed to hold x.
+ */
+static uint32_t bit_width(uint32_t x) {
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+BitPackedArray::BitPackedArray(const uint32_t* data, size_t n) :
+		count(n) {
+	uint32_t values[block_size];
+	for (size_t first = 0; first < n; first += block_size) {
+		size_t length = min(block_size, n - first);
+		uint32_t low = *min_element(data + first, data + first + length);
+		uint32_t high = *max_element(data + first, data + first + length);
+		Block block { low, bit_width(high - low), words.size() };
+		blocks.push_back(block);
+
+		for (size_t i = 0; i < block_size; i++) {
+			values[i] = i < length ? data[first + i] - low : 0;
+		}
+		// Lane l holds the integers l, l + 4, l + 8... one after another
+		words.resize(words.size() + lanes * block.bits);
+		uint32_t* out = words.data() + block.offset;
+		for (size_t j = 0; j < per_lane && block.bits > 0; j++) {
+			size_t position = j * block.bits;
+			size_t word = position / 32;
+			size_t shift = position % 32;
+			for (size_t l = 0; l < lanes; l++) {
+				uint32_t v = values[j * lanes + l];
+				out[word * lanes + l] |= v << shift;
+				if (shift + block.bits > 32) {
+					out[(word + 1) * lanes + l] |= v >> (32 - shift);
+				}
+			}
+		}
+	}
+}
+
+uint32_t BitPackedArray::operator[](size_t i) const {
+	const Block& block = blocks[i / block_size];
+	if (block.bits == 0) {
+		return block.base;
+	}
+	size_t within = i % block_size;
+	size_t lane = within % lanes;
+	size_t position = within / lanes * block.bits;
+	size_t word = position / 32;
+	size_t shift = position % 32;
+	const uint32_t* in = words.data() + block.offset;
+	uint64_t bits = in[word * lanes + lane];
+	if (shift + block.bits > 32) {
+		bits |= (uint64_t) in[(word + 1) * lanes + lane] << 32;
+	}
+	uint32_t mask = block.bits == 32 ? ~0u : (1u << block.bits) - 1;
+	return block.base + ((uint32_t) (bits >> shift) & mask);
+}
+
+void BitPackedArray::decode_block(size_t b, uint32_t* out) const {
+	const Block& block = blocks[b];
+	uint32_t bits = block.bits;
+	if (bits == 0) {
+		fill(out, out + block_size, block.base);
+		return;
+	}
+	const uint32_t* in = words.data() + block.offset;
+#ifdef __SSE2__
+	const __m128i mask = _mm_set1_epi32(bits == 32 ? ~0u : (1u << bits) - 1);
+	const __m128i base = _mm_set1_epi32(block.base);
+	__m128i word = _mm_loadu_si128((const __m128i*) in);
+	uint32_t shift = 0;
+	for (size_t j = 0; j < per_lane; j++) {
+		__m128i v = _mm_srl_epi32(word, _mm_cvtsi32_si128(shift));
+		shift += bits;
+		// The last integer of a lane ends exactly at the end of a word
+		if (shift >= 32 && j + 1 < per_lane) {
+			shift -= 32;
+			in += lanes;
+			word = _mm_loadu_si128((const __m128i*) in);
+			if (shift > 0) {
+				v = _mm_or_si128(v,
+						_mm_sll_epi32(word, _mm_cvtsi32_si128(bits - shift)));
+			}
+		}
+		v = _mm_add_epi32(_mm_and_si128(v, mask), base);
+		_mm_storeu_si128((__m128i*) (out + j * lanes), v);
+	}
+#else
+	uint32_t mask = bits == 32 ? ~0u : (1u << bits) - 1;
+	for (size_t l = 0; l < lanes; l++) {
+		for (size_t j = 0; j < per_lane; j++) {
+			size_t position = j * bits;
+			size_t word = position / 32;
+			size_t shift = position % 32;
+			uint64_t v = in[word * lanes + l];
+			if (shift + bits > 32) {
+				v |= (uint64_t) in[(word + 1) * lanes + l] << 32;
+			}
+			out[j * lanes + l] = block.base + ((uint32_t) (v >> shift) & mask);
+		}
+	}
+#endif
+}
+
+void BitPackedArray::decode(uint32_t* out) const {
+	size_t full = count / block_size;
+	for (size_t b = 0; b < full; b++) {
+		decode_block(b, out + b * block_size);
+	}
+	if (full < blocks.size()) {
+		uint32_t last[block_size];
+		decode_block(full, last);
+		memcpy(out + full * block_size, last,
+				(count - full * block_size) * sizeof(uint32_t));
+	}
+}
@@ -0,0 +1,168 @@
+#ifndef INT_CODEC_H_
+#define INT_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Maps signed integers to unsigned ones so that numbers close to zero, of
+ * either sign, become small: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+ */
+template<class T>
+constexpr std::make_unsigned_t<T> zigzag_encode(T x) {
+	using U = std::make_unsigned_t<T>;
+	return ((U) x << 1) ^ (U) (x >> (sizeof(T) * 8 - 1));
+}
+
+template<class U>
+constexpr std::make_signed_t<U> zigzag_decode(U x) {
+	return (std::make_signed_t<U>) ((x >> 1) ^ (U) -(x & 1));
+}
+
+static_assert(zigzag_encode(-1) == 1u && zigzag_encode(1) == 2u);
+static_assert(zigzag_decode(zigzag_encode(INT32_MIN)) == INT32_MIN);
+
+/**
+ * Appends n unsigned integers to out as LEB128 varints: 7 bits per byte,
+ * lowest first, with the high bit set on every byte but the last. Numbers
+ * below 128 take a single byte.
+ */
+template<class U>
+void varint_encode(const U* in, size_t n, std::vector<uint8_t>& out) {
+	static_assert(std::is_unsigned<U>::value, "zigzag encode signed numbers");
+	for (size_t i = 0; i < n; i++) {
+		U x = in[i];
+		while (x >= 0x80) {
+			out.push_back((uint8_t) x | 0x80);
+			x >>= 7;
+		}
+		out.push_back((uint8_t) x);
+	}
+}
+
+/**
+ * Decodes n varints from [in, end) into out, returning the end of the
+ * varints read. Returns null if the input ends within the n varints, or if
+ * a varint is larger than a U can hold.
+ */
+template<class U>
+const uint8_t* varint_decode(const uint8_t* in, const uint8_t* end, U* out,
+		size_t n) {
+	constexpr int bits = sizeof(U) * 8;
+	// The shift of the last byte that a U has room for
+	constexpr int last_shift = (bits - 1) / 7 * 7;
+	for (size_t i = 0; i < n; i++) {
+		U x = 0;
+		for (int shift = 0;; shift += 7) {
+			if (in == end) {
+				return nullptr;
+			}
+			uint8_t byte = *in++;
+			if (shift == last_shift) {
+				// Bits that do not fit, or a further byte, make it too large
+				if (byte >> (bits - shift)) {
+					return nullptr;
+				}
+				x |= (U) byte << shift;
+				break;
+			}
+			x |= (U) (byte & 0x7f) << shift;
+			if (!(byte & 0x80)) {
+				break;
+			}
+		}
+		out[i] = x;
+	}
+	return in;
+}
+
+/**
+ * Writes to out the zigzag encoded differences of consecutive elements of
+ * in, the first being the difference from zero. Sorted or slowly changing
+ * data becomes small numbers. The input and output may be the same.
+ */
+template<class T>
+void delta_encode(const T* in, std::make_unsigned_t<T>* out, size_t n) {
+	using U = std::make_unsigned_t<T>;
+	U previous = 0;
+	for (size_t i = 0; i < n; i++) {
+		U x = (U) in[i];
+		// Unsigned arithmetic, since the difference may overflow
+		out[i] = zigzag_encode((T) (x - previous));
+		previous = x;
+	}
+}
+
+template<class U>
+void delta_decode(const U* in, std::make_signed_t<U>* out, size_t n) {
+	U sum = 0;
+	for (size_t i = 0; i < n; i++) {
+		sum += (U) zigzag_decode(in[i]);
+		out[i] = (std::make_signed_t<U>) sum;
+	}
+}
+
+/**
+ * Array of unsigned 32 bit integers compressed with frame of reference bit
+ * packing.
+ *
+ * The array is split in blocks of 128 integers. Each block stores its
+ * smallest integer, and every integer as its difference from it using only
+ * as many bits as the largest difference needs. Integers are interleaved
+ * over four 32 bit lanes, integer i in lane i % 4, so a whole block is
+ * unpacked four integers at a time with SIMD shifts and masks.
+ *
+ * Blocks are independent, so any integer can be read without decoding the
+ * rest of the array.
+ */
+class BitPackedArray {
+	struct Block {
+		uint32_t base;
+		uint32_t bits;
+		// Index of the first word of the block
+		size_t offset;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<uint32_t> words;
+	size_t count;
+public:
+	static constexpr size_t block_size = 128;
+
+	BitPackedArray(const uint32_t* data, size_t n);
+
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * Returns the bytes taken by the compressed array.
+	 */
+	size_t size_bytes() const {
+		return blocks.size() * sizeof(Block) + words.size() * sizeof(uint32_t);
+	}
+
+	size_t block_count() const {
+		return blocks.size();
+	}
+
+	/**
+	 * Returns the integer at index i, unpacking only it.
+	 */
+	uint32_t operator[](size_t i) const;
+
+	/**
+	 * Unpacks the 128 integers of a block into out. Past the end of the
+	 * array, the last block is padded with its smallest integer.
+	 */
+	void decode_block(size_t block, uint32_t* out) const;
+
+	/**
+	 * Unpacks the whole array into out, which holds size() integers.
+	 */
+	void decode(uint32_t* out) const;
+};
+
+#endif /* INT_CODEC_H_ */
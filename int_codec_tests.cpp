@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "int_codec.h"
+#include "int_codec_tests.h"
+
+using namespace std;
+
+/**
+ * Returns n random integers below limit.
+ */
+static vector<uint32_t> random_data(size_t n, uint32_t limit, unsigned seed) {
+	mt19937 random(seed);
+	vector<uint32_t> data(n);
+	for (uint32_t& x : data) {
+		x = random() % limit;
+	}
+	return data;
+}
+
+/**
+ * Returns n sorted integers with random gaps of up to 100, such as a list
+ * of ids.
+ */
+static vector<uint32_t> sorted_data(size_t n, unsigned seed) {
+	mt19937 random(seed);
+	vector<uint32_t> data(n);
+	uint32_t x = 1000000;
+	for (uint32_t& y : data) {
+		x += random() % 100;
+		y = x;
+	}
+	return data;
+}
+
+/**
+ * Returns n integers that are mostly small, with a few large ones.
+ */
+static vector<uint32_t> skewed_data(size_t n, unsigned seed) {
+	mt19937 random(seed);
+	geometric_distribution<uint32_t> small(0.1);
+	vector<uint32_t> data(n);
+	for (uint32_t& x : data) {
+		x = random() % 1000 == 0 ? random() : small(random);
+	}
+	return data;
+}
+
+/**
+ * Tests zigzag and varint encoding of numbers at the edges of each byte
+ * length.
+ */
+void test_varint(void) {
+	assert(zigzag_encode(0) == 0u);
+	assert(zigzag_encode(-2) == 3u);
+	assert(zigzag_encode(INT_MAX) == UINT_MAX - 1);
+	assert(zigzag_encode(INT_MIN) == UINT_MAX);
+	assert(zigzag_decode(zigzag_encode(-123456789L)) == -123456789L);
+
+	vector<uint64_t> xs = { 0, 1, 127, 128, 16383, 16384, UINT32_MAX, UINT64_MAX };
+	vector<uint8_t> bytes;
+	varint_encode(xs.data(), xs.size(), bytes);
+	assert(bytes.size() == 1 + 1 + 1 + 2 + 2 + 3 + 5 + 10);
+	assert(bytes[3] == 0x80 && bytes[4] == 0x01);
+
+	vector<uint64_t> ys(xs.size());
+	const uint8_t* end = bytes.data() + bytes.size();
+	assert(varint_decode(bytes.data(), end, ys.data(), ys.size()) == end);
+	assert(ys == xs);
+
+	// Truncated input, and varints longer than their type, are rejected
+	assert(!varint_decode(bytes.data(), end - 1, ys.data(), ys.size()));
+	assert(!varint_decode(bytes.data(), bytes.data(), ys.data(), 1));
+	vector<uint8_t> overlong(20, 0x80);
+	overlong.push_back(0);
+	assert(!varint_decode(overlong.data(), overlong.data() + overlong.size(),
+			ys.data(), 1));
+	uint32_t small;
+	const uint8_t* wide = bytes.data() + bytes.size() - 10;
+	assert(!varint_decode(wide, end, &small, 1));
+	uint64_t big = ((uint64_t) 1 << 32) + 5;
+	vector<uint8_t> big_bytes;
+	varint_encode(&big, 1, big_bytes);
+	assert(!varint_decode(big_bytes.data(), big_bytes.data() + big_bytes.size(),
+			&small, 1));
+	const uint8_t too_high[] = { 0xff, 0xff, 0xff, 0xff, 0x7f };
+	assert(!varint_decode(too_high, too_high + 5, &small, 1));
+	const uint8_t max[] = { 0xff, 0xff, 0xff, 0xff, 0x0f };
+	assert(varint_decode(max, max + 5, &small, 1) == max + 5);
+	assert(small == UINT32_MAX);
+}
+
+/**
+ * Tests delta encoding, including differences that overflow.
+ */
+void test_delta(void) {
+	vector<int> xs = { 5, 7, 7, 3, INT_MAX, INT_MIN, 0 };
+	vector<unsigned> deltas(xs.size());
+	delta_encode(xs.data(), deltas.data(), xs.size());
+	assert(deltas[0] == 10 && deltas[1] == 4 && deltas[2] == 0
+			&& deltas[3] == 7);
+
+	vector<int> ys(xs.size());
+	delta_decode(deltas.data(), ys.data(), ys.size());
+	assert(ys == xs);
+}
+
+/**
+ * Tests that bit packing gives back the same integers, all at once, a block
+ * at a time and one at a time.
+ */
+void test_bit_packing(void) {
+	vector<vector<uint32_t>> inputs = { random_data(1000, 1 << 20, 1),
+			random_data(777, UINT32_MAX, 2), sorted_data(1280, 3),
+			skewed_data(5000, 4), vector<uint32_t>(300, 42), { }, { 7 } };
+	// Every bit width
+	for (uint32_t bits = 0; bits <= 32; bits++) {
+		vector<uint32_t> data(129, 1000);
+		data[5] = 1000 + (bits == 32 ? UINT32_MAX - 1000 : (1ull << bits) - 1);
+		inputs.push_back(data);
+	}
+
+	for (const vector<uint32_t>& data : inputs) {
+		BitPackedArray packed(data.data(), data.size());
+		assert(packed.size() == data.size());
+		assert(packed.block_count() == (data.size() + 127) / 128);
+
+		vector<uint32_t> out(data.size());
+		packed.decode(out.data());
+		assert(out == data);
+		for (size_t i = 0; i < data.size(); i++) {
+			assert(packed[i] == data[i]);
+		}
+		uint32_t block[BitPackedArray::block_size];
+		for (size_t b = 0; b < packed.block_count(); b++) {
+			packed.decode_block(b, block);
+			for (size_t i = 0; i < 128 && b * 128 + i < data.size(); i++) {
+				assert(block[i] == data[b * 128 + i]);
+			}
+		}
+	}
+
+	// Small integers take few bits
+	vector<uint32_t> small = random_data(12800, 16, 5);
+	BitPackedArray packed(small.data(), small.size());
+	assert(packed.size_bytes() < small.size() * sizeof(uint32_t) / 6);
+}
+
+void run_int_codec_tests(void) {
+	test_varint();
+	test_delta();
+	test_bit_packing();
+}
+
+/**
+ * Prints how much a codec compresses the data and how fast it decodes it.
+ */
+static void print_codec(const char* data_name, const char* codec, size_t n,
+		size_t bytes, double seconds) {
+	char label[64];
+	snprintf(label, sizeof(label), "%s, %s", codec, data_name);
+	printf("%-40s %12.3f ratio\n", label, (double) n * 4 / bytes);
+	print_rate(label, (double) n, seconds, "ints");
+}
+
+/**
+ * Compares varints and bit packing, with and without delta encoding, on
+ * the same data.
+ */
+void bench_codecs(const char* data_name, const vector<uint32_t>& data) {
+	const int rounds = 20;
+	size_t n = data.size();
+	vector<uint32_t> out(n);
+	vector<int32_t> signed_out(n);
+
+	vector<uint8_t> bytes;
+	varint_encode(data.data(), n, bytes);
+	double seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			varint_decode(bytes.data(), bytes.data() + bytes.size(), out.data(),
+					n);
+			do_not_optimize(out[0]);
+		}
+	});
+	assert(out == data);
+	print_codec(data_name, "varint", n, bytes.size(),
+			seconds / rounds);
+
+	vector<uint32_t> deltas(n);
+	delta_encode((const int32_t*) data.data(), deltas.data(), n);
+	vector<uint8_t> delta_bytes;
+	varint_encode(deltas.data(), n, delta_bytes);
+	seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			varint_decode(delta_bytes.data(),
+					delta_bytes.data() + delta_bytes.size(), out.data(), n);
+			delta_decode(out.data(), signed_out.data(), n);
+			do_not_optimize(signed_out[0]);
+		}
+	});
+	print_codec(data_name, "delta+varint", n, delta_bytes.size(),
+			seconds / rounds);
+
+	BitPackedArray packed(data.data(), n);
+	seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			packed.decode(out.data());
+			do_not_optimize(out[0]);
+		}
+	});
+	assert(out == data);
+	print_codec(data_name, "bitpack", n, packed.size_bytes(), seconds / rounds);
+
+	BitPackedArray packed_deltas(deltas.data(), n);
+	seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			packed_deltas.decode(out.data());
+			delta_decode(out.data(), signed_out.data(), n);
+			do_not_optimize(signed_out[0]);
+		}
+	});
+	assert(equal(data.begin(), data.end(), signed_out.begin(),
+			[](uint32_t a, int32_t b) { return a == (uint32_t) b; }));
+	print_codec(data_name, "delta+bitpack", n, packed_deltas.size_bytes(),
+			seconds / rounds);
+
+	// Random access to single integers, without decoding their blocks
+	mt19937 random(9);
+	vector<size_t> indices(1 << 20);
+	for (size_t& i : indices) {
+		i = random() % n;
+	}
+	seconds = time_seconds([&] {
+		uint32_t sum = 0;
+		for (size_t i : indices) {
+			sum += packed[i];
+		}
+		do_not_optimize(sum);
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "bitpack random access, %s", data_name);
+	print_rate(label, indices.size(), seconds, "ints");
+}
+
+void run_int_codec_benchmarks(void) {
+	const size_t n = 1 << 22;
+	bench_codecs("random", random_data(n, 1 << 20, 1));
+	bench_codecs("sorted", sorted_data(n, 2));
+	bench_codecs("skewed", skewed_data(n, 3));
+}
@@ -0,0 +1,7 @@
+#ifndef INT_CODEC_TESTS_H_
+#define INT_CODEC_TESTS_H_
+
+void run_int_codec_tests(void);
+void run_int_codec_benchmarks(void);
+
+#endif /* INT_CODEC_TESTS_H_ */
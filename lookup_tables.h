@@ -0,0 +1,243 @@
+#ifndef LOOKUP_TABLES_H_
+#define LOOKUP_TABLES_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "enumerated_types.h"
+
+/**
+ * Tables computed by the compiler.
+ *
+ * Each table is made by a consteval function, so it can only be computed
+ * at compile time, and stored in a constexpr variable, so it is part of the
+ * read only data of the binary. Nothing runs at startup to fill it, and no
+ * check of whether it was filled runs on each use, unlike a table that is
+ * filled by a static constructor or on first use. The functions that use
+ * the tables are constexpr too, and static_asserts check their results.
+ */
+
+/**
+ * Returns the table of a reflected CRC-32 with the given polynomial, which
+ * gives the CRC of each byte value.
+ */
+consteval std::array<uint32_t, 256> make_crc_table(uint32_t polynomial) {
+	std::array<uint32_t, 256> table { };
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+/**
+ * Table of the CRC-32 of zlib, PNG and Ethernet.
+ */
+inline constexpr std::array<uint32_t, 256> crc32_table = make_crc_table(
+		0xEDB88320);
+
+/**
+ * Table of the CRC-32C (Castagnoli) of iSCSI and ext4.
+ */
+inline constexpr std::array<uint32_t, 256> crc32c_table = make_crc_table(
+		0x82F63B78);
+
+/**
+ * Returns the CRC of the data with the given table, continuing from a
+ * previous CRC, one byte at a time.
+ */
+constexpr uint32_t crc_update(const std::array<uint32_t, 256>& table,
+		std::string_view data, uint32_t crc = 0) {
+	crc = ~crc;
+	for (char c : data) {
+		crc = table[(crc ^ (uint8_t) c) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+constexpr uint32_t crc32(std::string_view data, uint32_t crc = 0) {
+	return crc_update(crc32_table, data, crc);
+}
+
+constexpr uint32_t crc32c(std::string_view data, uint32_t crc = 0) {
+	return crc_update(crc32c_table, data, crc);
+}
+
+// The standard check values
+static_assert(crc32_table[1] == 0x77073096);
+static_assert(crc32("123456789") == 0xCBF43926);
+static_assert(crc32c("123456789") == 0xE3069283);
+static_assert(crc32("56789", crc32("1234")) == crc32("123456789"));
+
+/**
+ * Returns the number of bits set in each byte value.
+ */
+consteval std::array<uint8_t, 256> make_popcount_table() {
+	std::array<uint8_t, 256> table { };
+	for (int i = 1; i < 256; i++) {
+		table[i] = (i & 1) + table[i / 2];
+	}
+	return table;
+}
+
+inline constexpr std::array<uint8_t, 256> popcount_table =
+		make_popcount_table();
+
+/**
+ * Returns the number of bits set, a byte at a time.
+ */
+constexpr int popcount_lookup(uint64_t x) {
+	int n = 0;
+	for (int i = 0; i < 8; i++) {
+		n += popcount_table[(x >> (i * 8)) & 0xff];
+	}
+	return n;
+}
+
+static_assert(popcount_lookup(0) == 0);
+static_assert(popcount_lookup(0xff) == 8);
+static_assert(popcount_lookup(~0ull) == 64);
+static_assert(popcount_lookup(0x8000000000000001ull) == 2);
+
+/**
+ * Returns each byte value with its bits in reverse order.
+ */
+consteval std::array<uint8_t, 256> make_reverse_table() {
+	std::array<uint8_t, 256> table { };
+	for (int i = 0; i < 256; i++) {
+		int r = 0;
+		for (int bit = 0; bit < 8; bit++) {
+			r |= ((i >> bit) & 1) << (7 - bit);
+		}
+		table[i] = r;
+	}
+	return table;
+}
+
+inline constexpr std::array<uint8_t, 256> reverse_table = make_reverse_table();
+
+/**
+ * Returns x with its bits in reverse order, a byte at a time.
+ */
+constexpr uint32_t reverse_bits(uint32_t x) {
+	return (uint32_t) reverse_table[x & 0xff] << 24
+			| (uint32_t) reverse_table[(x >> 8) & 0xff] << 16
+			| (uint32_t) reverse_table[(x >> 16) & 0xff] << 8
+			| reverse_table[x >> 24];
+}
+
+static_assert(reverse_bits(1) == 0x80000000);
+static_assert(reverse_bits(0x12345678) == 0x1E6A2C48);
+static_assert(reverse_bits(reverse_bits(0xDEADBEEF)) == 0xDEADBEEF);
+
+/**
+ * Days of each month of a common year.
+ */
+inline constexpr std::array<uint8_t, 12> month_days = { 31, 28, 31, 30, 31,
+		30, 31, 31, 30, 31, 30, 31 };
+
+/**
+ * Returns the days of the year before the first day of each month of a
+ * common year.
+ */
+consteval std::array<uint16_t, 12> make_days_before_month() {
+	std::array<uint16_t, 12> table { };
+	for (int m = 1; m < 12; m++) {
+		table[m] = table[m - 1] + month_days[m - 1];
+	}
+	return table;
+}
+
+inline constexpr std::array<uint16_t, 12> days_before_month =
+		make_days_before_month();
+
+constexpr bool is_leap_year(int year) {
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+constexpr int days_in_month(Month month, int year) {
+	return month_days[(int) month]
+			+ (month == Month::February && is_leap_year(year));
+}
+
+/**
+ * Returns the day of the year, from 1, of a day of a month, from 1.
+ */
+constexpr int day_of_year(int year, Month month, int day) {
+	return days_before_month[(int) month] + day
+			+ (month > Month::February && is_leap_year(year));
+}
+
+static_assert(days_in_month(Month::February, 2024) == 29);
+static_assert(days_in_month(Month::February, 1900) == 28);
+static_assert(days_in_month(Month::December, 2023) == 31);
+static_assert(day_of_year(2023, Month::December, 31) == 365);
+static_assert(day_of_year(2000, Month::December, 31) == 366);
+static_assert(day_of_year(2024, Month::March, 1) == 61);
+
+/**
+ * Classes of characters, as bits that can be combined.
+ */
+enum CharClass : uint8_t {
+	CharDigit = 1,
+	CharUpper = 2,
+	CharLower = 4,
+	CharSpace = 8,
+	CharPunct = 16,
+	CharHexDigit = 32,
+	CharAlpha = CharUpper | CharLower,
+	CharAlnum = CharAlpha | CharDigit
+};
+
+/**
+ * Returns the classes of each byte value, in the "C" locale. Bytes above
+ * 127 belong to no class.
+ */
+consteval std::array<uint8_t, 256> make_char_class_table() {
+	std::array<uint8_t, 256> table { };
+	for (int c = 0; c < 128; c++) {
+		uint8_t bits = 0;
+		if (c >= '0' && c <= '9') {
+			bits |= CharDigit | CharHexDigit;
+		}
+		if (c >= 'A' && c <= 'Z') {
+			bits |= CharUpper;
+		}
+		if (c >= 'a' && c <= 'z') {
+			bits |= CharLower;
+		}
+		if ((c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f')) {
+			bits |= CharHexDigit;
+		}
+		if (c == ' ' || (c >= '\t' && c <= '\r')) {
+			bits |= CharSpace;
+		}
+		if (c > ' ' && c < 127 && !(bits & CharAlnum)) {
+			bits |= CharPunct;
+		}
+		table[c] = bits;
+	}
+	return table;
+}
+
+inline constexpr std::array<uint8_t, 256> char_class_table =
+		make_char_class_table();
+
+/**
+ * Returns whether c belongs to any of the given classes.
+ */
+constexpr bool is_char_class(char c, uint8_t classes) {
+	return char_class_table[(uint8_t) c] & classes;
+}
+
+static_assert(is_char_class('7', CharDigit) && !is_char_class('a', CharDigit));
+static_assert(is_char_class('F', CharHexDigit | CharUpper));
+static_assert(!is_char_class('g', CharHexDigit));
+static_assert(is_char_class('\n', CharSpace) && is_char_class('_', CharPunct));
+static_assert(!is_char_class('\xe9', CharAlpha));
+
+#endif /* LOOKUP_TABLES_H_ */
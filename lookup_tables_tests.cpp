@@ -0,0 +1,281 @@
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "enumerated_types.h"
+#include "lookup_tables.h"
+#include "lookup_tables_tests.h"
+
+using namespace std;
+
+/**
+ * Returns the CRC-32 of the data computed a bit at a time, without a table.
+ */
+static uint32_t crc32_bitwise(string_view data, uint32_t polynomial =
+		0xEDB88320) {
+	uint32_t crc = ~0u;
+	for (char c : data) {
+		crc ^= (uint8_t) c;
+		for (int bit = 0; bit < 8; bit++) {
+			if (crc & 1) {
+				crc = (crc >> 1) ^ polynomial;
+			} else {
+				crc >>= 1;
+			}
+		}
+	}
+	return ~crc;
+}
+
+/**
+ * Returns a CRC-32 table computed at run time.
+ */
+static vector<uint32_t> fill_crc32_table(void) {
+	vector<uint32_t> table(256);
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+/**
+ * Returns a CRC-32 table filled the first time it is asked for, as tables
+ * often are, so every call checks whether it was filled. Each Instance has
+ * a table of its own, so a benchmark can time a first call even after the
+ * tests used the table.
+ */
+template<int Instance = 0>
+static const vector<uint32_t>& runtime_crc32_table(void) {
+	static const vector<uint32_t> table = fill_crc32_table();
+	return table;
+}
+
+template<int Instance = 0>
+static uint32_t crc32_runtime_table(string_view data) {
+	uint32_t crc = ~0u;
+	for (char c : data) {
+		crc = runtime_crc32_table<Instance>()[(crc ^ (uint8_t) c) & 0xff]
+				^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+/**
+ * Returns the number of bits set, one bit at a time.
+ */
+static int popcount_branchy(uint64_t x) {
+	int n = 0;
+	while (x) {
+		if (x & 1) {
+			n++;
+		}
+		x >>= 1;
+	}
+	return n;
+}
+
+static bool is_alnum_branchy(char c) {
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z')
+			|| (c >= 'a' && c <= 'z');
+}
+
+static int days_in_month_switch(Month month, int year) {
+	switch (month) {
+	case Month::February:
+		return is_leap_year(year) ? 29 : 28;
+	case Month::April:
+	case Month::June:
+	case Month::September:
+	case Month::November:
+		return 30;
+	default:
+		return 31;
+	}
+}
+
+/**
+ * Tests the tables against the obvious implementations, for every input
+ * that indexes them.
+ */
+void test_lookup_tables(void) {
+	string data;
+	mt19937 random(1);
+	for (int i = 0; i < 1000; i++) {
+		data += (char) random();
+		assert(crc32(data) == crc32_bitwise(data));
+		assert(crc32c(data) == crc32_bitwise(data, 0x82F63B78));
+		assert(crc32(data) == crc32_runtime_table(data));
+	}
+
+	for (int i = 0; i < 10000; i++) {
+		uint64_t x = (uint64_t) random() << 32 | random();
+		assert(popcount_lookup(x) == __builtin_popcountll(x));
+		assert(popcount_lookup(x) == popcount_branchy(x));
+		uint32_t r = 0;
+		for (int bit = 0; bit < 32; bit++) {
+			r |= (((uint32_t) x >> bit) & 1) << (31 - bit);
+		}
+		assert(reverse_bits((uint32_t) x) == r);
+	}
+
+	for (int c = 0; c < 256; c++) {
+		char ch = (char) c;
+		bool ascii = c < 128;
+		assert(is_char_class(ch, CharDigit) == (ascii && isdigit(c)));
+		assert(is_char_class(ch, CharAlpha) == (ascii && isalpha(c)));
+		assert(is_char_class(ch, CharUpper) == (ascii && isupper(c)));
+		assert(is_char_class(ch, CharLower) == (ascii && islower(c)));
+		assert(is_char_class(ch, CharSpace) == (ascii && isspace(c)));
+		assert(is_char_class(ch, CharPunct) == (ascii && ispunct(c)));
+		assert(is_char_class(ch, CharHexDigit) == (ascii && isxdigit(c)));
+		assert(is_char_class(ch, CharAlnum) == is_alnum_branchy(ch));
+	}
+
+	for (int year : { 1900, 2000, 2023, 2024 }) {
+		int day = 0;
+		for (int m = 0; m < 12; m++) {
+			Month month = (Month) m;
+			assert(days_in_month(month, year) == days_in_month_switch(month, year));
+			assert(day_of_year(year, month, 1) == day + 1);
+			day += days_in_month(month, year);
+		}
+		assert(day == (is_leap_year(year) ? 366 : 365));
+	}
+}
+
+void run_lookup_tables_tests(void) {
+	test_lookup_tables();
+}
+
+/**
+ * Compares the compile time tables with tables filled at run time and with
+ * implementations that use no table.
+ */
+void bench_lookup_tables(void) {
+	const size_t bytes = 1 << 24;
+	string data(bytes, 0);
+	mt19937 random(2);
+	for (char& c : data) {
+		c = (char) (32 + random() % 95);
+	}
+
+	// The first call with a runtime table also fills it, while a compile
+	// time table is already in the binary, so its first call costs about as
+	// much as the next one. Both first calls may still miss the cache
+	string_view short_data(data.data(), 9);
+	auto print_first_and_next = [&](const char* first, const char* next,
+			auto crc) {
+		printf("%-40s %12.3f us\n", first, time_seconds([&] {
+			do_not_optimize(crc(short_data));
+		}) * 1e6);
+		printf("%-40s %12.3f us\n", next, time_seconds([&] {
+			do_not_optimize(crc(short_data));
+		}) * 1e6);
+	};
+	print_first_and_next("runtime CRC table, first call",
+			"runtime CRC table, next call", crc32_runtime_table<1>);
+	print_first_and_next("constexpr CRC table, first call",
+			"constexpr CRC table, next call", [](string_view d) {
+				return crc32(d);
+			});
+
+	double seconds = time_seconds([&] {
+		do_not_optimize(crc32(data));
+	});
+	print_rate("crc32 (constexpr table)", bytes, seconds, "B");
+	seconds = time_seconds([&] {
+		do_not_optimize(crc32_runtime_table(data));
+	});
+	print_rate("crc32 (runtime table)", bytes, seconds, "B");
+	seconds = time_seconds([&] {
+		do_not_optimize(crc32_bitwise(data.substr(0, bytes / 8)));
+	});
+	print_rate("crc32 (bitwise)", bytes / 8, seconds, "B");
+
+	vector<uint64_t> words(1 << 22);
+	for (uint64_t& w : words) {
+		w = (uint64_t) random() << 32 | random();
+	}
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (uint64_t w : words) {
+			n += popcount_lookup(w);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("popcount (constexpr table)", words.size(), seconds, "words");
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (uint64_t w : words) {
+			n += popcount_branchy(w);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("popcount (bit loop)", words.size(), seconds, "words");
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (uint64_t w : words) {
+			n += __builtin_popcountll(w);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("popcount (builtin)", words.size(), seconds, "words");
+
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (char c : data) {
+			n += is_char_class(c, CharAlnum);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("is alnum (constexpr table)", bytes, seconds, "chars");
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (char c : data) {
+			n += is_alnum_branchy(c);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("is alnum (comparisons)", bytes, seconds, "chars");
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (char c : data) {
+			n += isalnum((unsigned char) c) != 0;
+		}
+		do_not_optimize(n);
+	});
+	print_rate("is alnum (<cctype>)", bytes, seconds, "chars");
+
+	vector<Month> months(1 << 22);
+	for (Month& m : months) {
+		m = (Month) (random() % 12);
+	}
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (Month m : months) {
+			n += days_in_month(m, 2024);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("days_in_month (constexpr table)", months.size(), seconds,
+			"months");
+	seconds = time_seconds([&] {
+		long n = 0;
+		for (Month m : months) {
+			n += days_in_month_switch(m, 2024);
+		}
+		do_not_optimize(n);
+	});
+	print_rate("days_in_month (switch)", months.size(), seconds, "months");
+}
+
+void run_lookup_tables_benchmarks(void) {
+	bench_lookup_tables();
+}
@@ -0,0 +1,7 @@
+#ifndef LOOKUP_TABLES_TESTS_H_
+#define LOOKUP_TABLES_TESTS_H_
+
+void run_lookup_tables_tests(void);
+void run_lookup_tables_benchmarks(void);
+
+#endif /* LOOKUP_TABLES_TESTS_H_ */
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "array_tests.h"
 #include "char_seq_tests.h"
 #include "pointer_tests.h"
@@ -6,16 +7,129 @@
 #include "type_aliases_tests.h"
 #include "union_tests.h"
 #include "enumerated_types_tests.h"
+#include "span_tests.h"
+#include "memory_probe_tests.h"
+#include "ref_ptr_tests.h"
+#include "pool_alloc_tests.h"
+#include "ring_buffer_tests.h"
+#include "concurrent_map_tests.h"
+#include "flat_hash_map_tests.h"
+#include "parallel_algorithms_tests.h"
+#include "char_stream_tests.h"
+#include "mapped_file_tests.h"
+#include "perf_counters_tests.h"
+#include "output_sink_tests.h"
+#include "thread_cache_alloc_tests.h"
+#include "int_codec_tests.h"
+#include "small_vector_tests.h"
+#include "stats_counters_tests.h"
+#include "lookup_tables_tests.h"
+#include "trace_tests.h"
+#include "btree_tests.h"
+#include "perf_counters.h"
+#include "trace.h"
 
-int main(void) {
-	run_array_tests();
-	run_char_seq_tests();
-	run_pointer_tests();
-	run_dynamic_memory_tests();
-	run_data_structures_tests();
-	run_type_aliases_tests();
-	run_union_tests();
-	run_enumerated_types_tests();
+/**
+ * A group of tests or benchmarks run by main.
+ */
+struct Suite {
+	const char* name;
+	void (*run)(void);
+};
+
+static const Suite tests[] = {
+	{ "array", run_array_tests },
+	{ "char_seq", run_char_seq_tests },
+	{ "pointer", run_pointer_tests },
+	{ "dynamic_memory", run_dynamic_memory_tests },
+	{ "data_structures", run_data_structures_tests },
+	{ "type_aliases", run_type_aliases_tests },
+	{ "union", run_union_tests },
+	{ "enumerated_types", run_enumerated_types_tests },
+	{ "span", run_span_tests },
+	{ "memory_probe", run_memory_probe_tests },
+	{ "ref_ptr", run_ref_ptr_tests },
+	{ "pool_alloc", run_pool_alloc_tests },
+	{ "ring_buffer", run_ring_buffer_tests },
+	{ "concurrent_map", run_concurrent_map_tests },
+	{ "flat_hash_map", run_flat_hash_map_tests },
+	{ "parallel_algorithms", run_parallel_algorithms_tests },
+	{ "char_stream", run_char_stream_tests },
+	{ "mapped_file", run_mapped_file_tests },
+	{ "perf_counters", run_perf_counters_tests },
+	{ "output_sink", run_output_sink_tests },
+	{ "thread_cache_alloc", run_thread_cache_alloc_tests },
+	{ "int_codec", run_int_codec_tests },
+	{ "small_vector", run_small_vector_tests },
+	{ "stats_counters", run_stats_counters_tests },
+	{ "lookup_tables", run_lookup_tables_tests },
+	{ "trace", run_trace_tests },
+	{ "btree", run_btree_tests },
+};
+
+static const Suite benchmarks[] = {
+	{ "pointer", run_pointer_benchmarks },
+	{ "span", run_span_benchmarks },
+	{ "memory_probe", run_memory_probe_benchmarks },
+	{ "ref_ptr", run_ref_ptr_benchmarks },
+	{ "pool_alloc", run_pool_alloc_benchmarks },
+	{ "ring_buffer", run_ring_buffer_benchmarks },
+	{ "concurrent_map", run_concurrent_map_benchmarks },
+	{ "flat_hash_map", run_flat_hash_map_benchmarks },
+	{ "parallel_algorithms", run_parallel_algorithms_benchmarks },
+	{ "char_stream", run_char_stream_benchmarks },
+	{ "mapped_file", run_mapped_file_benchmarks },
+	{ "perf_counters", run_perf_counters_benchmarks },
+	{ "output_sink", run_output_sink_benchmarks },
+	{ "thread_cache_alloc", run_thread_cache_alloc_benchmarks },
+	{ "int_codec", run_int_codec_benchmarks },
+	{ "small_vector", run_small_vector_benchmarks },
+	{ "stats_counters", run_stats_counters_benchmarks },
+	{ "lookup_tables", run_lookup_tables_benchmarks },
+	{ "trace", run_trace_benchmarks },
+	{ "btree", run_btree_benchmarks },
+};
+
+/**
+ * Runs every suite, counting the hardware events of each one if perf is set.
+ * Each suite is a span of the trace.
+ */
+template<size_t N>
+static void run_suites(const Suite (&suites)[N], bool perf) {
+	for (const Suite& suite : suites) {
+		TraceSpan span(suite.name);
+		if (perf) {
+			measure(suite.name, 1, suite.run);
+		} else {
+			suite.run();
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	bool bench = false;
+	bool memory = false;
+	bool perf = false;
+	for (int i = 1; i < argc; i++) {
+		bench = bench || strcmp(argv[i], "--bench") == 0;
+		memory = memory || strcmp(argv[i], "--memory") == 0;
+		perf = perf || strcmp(argv[i], "--perf") == 0;
+		if (strcmp(argv[i], "--trace") == 0) {
+			trace_at_exit("trace.json");
+		}
+	}
+
+	run_suites(tests, perf && !bench);
+
+	// Benchmarks take a while, so they only run when asked for
+	if (bench) {
+		run_suites(benchmarks, perf);
+	}
+
+	// Characterizes the memory hierarchy of the host only
+	if (memory) {
+		run_memory_probe_benchmarks();
+	}
 
 	return 0;
 }
@@ -0,0 +1,106 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include "mapped_file.h"
+
+using namespace std;
+
+/**
+ * Throws the error of the last failed system call.
+ */
+static void throw_errno(const char* what) {
+	throw system_error(errno, generic_category(), what);
+}
+
+File::File(const char* path) :
+		fd(open(path, O_RDONLY | O_CLOEXEC)) {
+	if (fd < 0) {
+		throw_errno(path);
+	}
+}
+
+File::~File() {
+	close(fd);
+}
+
+size_t File::size() const {
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		throw_errno("fstat");
+	}
+	return st.st_size;
+}
+
+size_t File::read_at(void* buffer, size_t count, size_t offset) const {
+	size_t done = 0;
+	while (done < count) {
+		ssize_t n = pread(fd, (char*) buffer + done, count - done,
+				offset + done);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw_errno("pread");
+		}
+		if (n == 0) {
+			break;
+		}
+		done += n;
+	}
+	return done;
+}
+
+void File::drop_cache() const {
+	// Dirty pages are not dropped, so recent writes are flushed first
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+MappedFile::MappedFile(const char* path) :
+		file(path), data(nullptr), length(file.size()) {
+	// An empty file can not be mapped, but is a valid empty array
+	if (length == 0) {
+		return;
+	}
+	data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file.descriptor(), 0);
+	if (data == MAP_FAILED) {
+		throw_errno("mmap");
+	}
+	madvise(data, length, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+	if (data) {
+		munmap(data, length);
+	}
+}
+
+void MappedFile::will_need(size_t offset, size_t count) const {
+	if (offset >= length) {
+		return;
+	}
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t first = offset / page * page;
+	size_t last = min(offset + count, length);
+	madvise((char*) data + first, last - first, MADV_WILLNEED);
+}
+
+void MappedFile::done_with(size_t offset, size_t count) const {
+	if (offset >= length) {
+		return;
+	}
+	// Ranges are released in order, so the page shared with the range before
+	// can go, but the page shared with the range after must stay
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t first = offset / page * page;
+	size_t last = min(offset + count, length);
+	if (last < length) {
+		last = last / page * page;
+	}
+	if (last > first) {
+		madvise((char*) data + first, last - first, MADV_DONTNEED);
+	}
+}
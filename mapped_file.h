@@ -0,0 +1,174 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include "span.h"
+
+/**
+ * Bytes read by a reader and how long it took.
+ */
+struct ReadStats {
+	size_t bytes = 0;
+	double seconds = 0;
+
+	double bytes_per_second() const {
+		return seconds > 0 ? bytes / seconds : 0;
+	}
+};
+
+/**
+ * A read only file descriptor, closed when destroyed.
+ *
+ * Throws 'std::system_error' if the file can not be opened.
+ */
+class File {
+	int fd;
+public:
+	explicit File(const char* path);
+	~File();
+
+	File(const File&) = delete;
+	File& operator=(const File&) = delete;
+
+	int descriptor() const {
+		return fd;
+	}
+
+	size_t size() const;
+
+	/**
+	 * Reads up to count bytes at the given offset, returning how many were
+	 * read, which is less than count only at the end of the file.
+	 */
+	size_t read_at(void* buffer, size_t count, size_t offset) const;
+
+	/**
+	 * Writes the file's dirty pages to the disk and asks the kernel to drop
+	 * its pages from the page cache, so that the next read comes from the
+	 * disk.
+	 */
+	void drop_cache() const;
+};
+
+/**
+ * A file mapped into memory, read only.
+ *
+ * The kernel is told the file will be read sequentially, so it reads ahead
+ * aggressively and drops pages behind the reader sooner.
+ */
+class MappedFile {
+	File file;
+	void* data;
+	size_t length;
+public:
+	explicit MappedFile(const char* path);
+	~MappedFile();
+
+	const void* bytes() const {
+		return data;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	/**
+	 * Asks the kernel to start reading the given range in the background.
+	 */
+	void will_need(size_t offset, size_t count) const;
+
+	/**
+	 * Tells the kernel the given range will not be read again, so its pages
+	 * can be reclaimed and memory use stays bounded on huge files.
+	 */
+	void done_with(size_t offset, size_t count) const;
+};
+
+/**
+ * A binary file of values of type T, such as 'int' or 'long', mapped into
+ * memory and viewed as an array.
+ *
+ * Trailing bytes that do not make a whole value are ignored.
+ */
+template<class T>
+class MappedArray {
+	MappedFile file;
+public:
+	explicit MappedArray(const char* path) :
+			file(path) {
+	}
+
+	size_t size() const {
+		return file.size() / sizeof(T);
+	}
+
+	Span<const T> span() const {
+		return Span<const T>((const T*) file.bytes(), size());
+	}
+
+	/**
+	 * Calls func with a span of each chunk of up to chunk_size values, in
+	 * order. While a chunk is processed the next one is being read ahead,
+	 * and chunks already processed are released.
+	 */
+	template<class F>
+	ReadStats for_each_chunk(size_t chunk_size, F func) const {
+		auto start = std::chrono::steady_clock::now();
+		Span<const T> all = span();
+		for (size_t first = 0; first < all.size(); first += chunk_size) {
+			size_t count = std::min(chunk_size, all.size() - first);
+			file.will_need((first + count) * sizeof(T), chunk_size * sizeof(T));
+			func(all.subspan(first, count));
+			file.done_with(first * sizeof(T), count * sizeof(T));
+		}
+		ReadStats stats;
+		stats.bytes = all.size() * sizeof(T);
+		stats.seconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+};
+
+/**
+ * Reads a binary file of values of type T in chunks with 'pread', into a
+ * single buffer that is reused for every chunk.
+ *
+ * It is a fallback for files that can not be mapped, such as files on
+ * filesystems without mmap support. Like a mapping, it needs a file that
+ * has a size and can be read at any offset, so pipes can not be read.
+ */
+template<class T>
+class PreadArray {
+	File file;
+public:
+	explicit PreadArray(const char* path) :
+			file(path) {
+	}
+
+	size_t size() const {
+		return file.size() / sizeof(T);
+	}
+
+	template<class F>
+	ReadStats for_each_chunk(size_t chunk_size, F func) const {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<T> buffer(chunk_size);
+		size_t total = size();
+		for (size_t first = 0; first < total; first += chunk_size) {
+			size_t count = std::min(chunk_size, total - first);
+			size_t n = file.read_at(buffer.data(), count * sizeof(T),
+					first * sizeof(T)) / sizeof(T);
+			func(Span<const T>(buffer.data(), n));
+		}
+		ReadStats stats;
+		stats.bytes = total * sizeof(T);
+		stats.seconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+};
+
+#endif /* MAPPED_FILE_H_ */
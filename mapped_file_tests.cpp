@@ -0,0 +1,176 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+#include "benchmark.h"
+#include "mapped_file.h"
+#include "mapped_file_tests.h"
+
+using namespace std;
+
+/**
+ * Returns the path of a new temporary file.
+ */
+static string temp_path(void) {
+	char path[] = "/tmp/cpptests_XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	return path;
+}
+
+/**
+ * Writes count values of type T, where value i is i * 3, to the given file,
+ * followed by extra bytes that do not make a whole value.
+ */
+template<class T>
+static void write_values(const string& path, size_t count, size_t extra = 0) {
+	FILE* file = fopen(path.c_str(), "wb");
+	vector<T> chunk(1 << 16);
+	for (size_t first = 0; first < count; first += chunk.size()) {
+		size_t n = min(chunk.size(), count - first);
+		for (size_t i = 0; i < n; i++) {
+			chunk[i] = (T) ((first + i) * 3);
+		}
+		fwrite(chunk.data(), sizeof(T), n, file);
+	}
+	for (size_t i = 0; i < extra; i++) {
+		fputc(1, file);
+	}
+	fclose(file);
+}
+
+/**
+ * Tests reading a file of values through a mapping and with pread, in
+ * chunks that do not divide the file evenly.
+ */
+template<class T>
+void test_read_values(void) {
+	string path = temp_path();
+	const size_t count = 100003;
+	write_values<T>(path, count, sizeof(T) - 1);
+
+	MappedArray<T> mapped(path.c_str());
+	assert(mapped.size() == count);
+	Span<const T> values = mapped.span();
+	assert(values[0] == 0);
+	assert(values[count - 1] == (T) ((count - 1) * 3));
+
+	size_t seen = 0;
+	ReadStats stats = mapped.for_each_chunk(4099, [&](Span<const T> chunk) {
+		for (T x : chunk) {
+			assert(x == (T) (seen++ * 3));
+		}
+	});
+	assert(seen == count);
+	assert(stats.bytes == count * sizeof(T));
+
+	// Values are still readable after their chunk was released
+	assert(values[10] == 30);
+
+	PreadArray<T> read(path.c_str());
+	assert(read.size() == count);
+	seen = 0;
+	read.for_each_chunk(4099, [&](Span<const T> chunk) {
+		for (T x : chunk) {
+			assert(x == (T) (seen++ * 3));
+		}
+	});
+	assert(seen == count);
+	unlink(path.c_str());
+}
+
+/**
+ * Tests the edge cases of empty and missing files.
+ */
+void test_empty_and_missing_files(void) {
+	string path = temp_path();
+	MappedArray<int> empty(path.c_str());
+	assert(empty.size() == 0);
+	empty.for_each_chunk(16, [](Span<const int>) {
+		assert(false);
+	});
+	unlink(path.c_str());
+
+	bool thrown = false;
+	try {
+		MappedArray<int> missing(path.c_str());
+	} catch (system_error& e) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+void run_mapped_file_tests(void) {
+	test_read_values<int>();
+	test_read_values<long>();
+	test_empty_and_missing_files();
+}
+
+/**
+ * Sums a file of longs with each reader, first with the file out of the
+ * page cache and then with it cached, and prints the bytes per second.
+ */
+void bench_readers(const string& path, bool cold) {
+	const size_t chunk = 1 << 20;
+	const char* cache = cold ? "cold" : "warm";
+	char label[64];
+	auto prepare = [&] {
+		if (cold) {
+			File(path.c_str()).drop_cache();
+		}
+	};
+
+	prepare();
+	long sum = 0;
+	ReadStats mapped = MappedArray<long>(path.c_str()).for_each_chunk(chunk,
+			[&](Span<const long> values) {
+				for (long x : values) {
+					sum += x;
+				}
+			});
+	snprintf(label, sizeof(label), "mmap, %s cache", cache);
+	print_rate(label, mapped.bytes, mapped.seconds, "B");
+
+	prepare();
+	long pread_sum = 0;
+	ReadStats read = PreadArray<long>(path.c_str()).for_each_chunk(chunk,
+			[&](Span<const long> values) {
+				for (long x : values) {
+					pread_sum += x;
+				}
+			});
+	snprintf(label, sizeof(label), "pread, %s cache", cache);
+	print_rate(label, read.bytes, read.seconds, "B");
+
+	prepare();
+	long stream_sum = 0;
+	size_t bytes = 0;
+	double seconds = time_seconds([&] {
+		ifstream in(path, ios::binary);
+		vector<long> buffer(chunk);
+		while (in.read((char*) buffer.data(), chunk * sizeof(long))
+				|| in.gcount() > 0) {
+			size_t n = in.gcount() / sizeof(long);
+			for (size_t i = 0; i < n; i++) {
+				stream_sum += buffer[i];
+			}
+			bytes += in.gcount();
+		}
+	});
+	snprintf(label, sizeof(label), "ifstream, %s cache", cache);
+	print_rate(label, bytes, seconds, "B");
+	assert(sum == pread_sum && sum == stream_sum);
+}
+
+void run_mapped_file_benchmarks(void) {
+	string path = temp_path();
+	write_values<long>(path, (size_t) 1 << 27);
+	bench_readers(path, true);
+	bench_readers(path, false);
+	unlink(path.c_str());
+}
@@ -0,0 +1,7 @@
+#ifndef MAPPED_FILE_TESTS_H_
+#define MAPPED_FILE_TESTS_H_
+
+void run_mapped_file_tests(void);
+void run_mapped_file_benchmarks(void);
+
+#endif /* MAPPED_FILE_TESTS_H_ */
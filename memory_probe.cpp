@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include "benchmark.h"
+#include "memory_probe.h"
+
+using namespace std;
+
+/**
+ * A node of a pointer chasing chain, one per cache line, so that no two
+ * consecutive loads hit the same line.
+ */
+struct alignas(64) ChaseNode {
+	ChaseNode* next;
+};
+
+/**
+ * Bytes each bandwidth kernel moves, regardless of the working set size, so
+ * small sets are swept many times and timings are long enough to be precise.
+ */
+static const size_t bandwidth_traffic = 512 << 20;
+
+vector<size_t> make_chase_order(size_t count, unsigned seed) {
+	vector<size_t> visits(count);
+	for (size_t i = 0; i < count; i++) {
+		visits[i] = i;
+	}
+	// Node 0 stays first, the rest is visited in random order
+	shuffle(visits.begin() + 1, visits.end(), mt19937_64(seed));
+
+	vector<size_t> next(count);
+	for (size_t i = 0; i < count; i++) {
+		next[visits[i]] = visits[(i + 1) % count];
+	}
+	return next;
+}
+
+double chase_latency_ns(size_t bytes) {
+	size_t count = max(bytes / sizeof(ChaseNode), (size_t) 1);
+	vector<ChaseNode> nodes(count);
+	vector<size_t> next = make_chase_order(count, 42);
+	for (size_t i = 0; i < count; i++) {
+		nodes[i].next = &nodes[next[i]];
+	}
+
+	// Walks the chain once to load it into whatever cache level it fits
+	ChaseNode* p = &nodes[0];
+	for (size_t i = 0; i < count; i++) {
+		p = p->next;
+	}
+
+	const size_t steps = 1 << 22;
+	double seconds = time_seconds([&] {
+		for (size_t i = 0; i < steps; i++) {
+			p = p->next;
+		}
+	});
+	do_not_optimize(p);
+	return seconds / steps * 1e9;
+}
+
+/**
+ * Returns the bytes moved by one pass with the given stride: a whole line
+ * for every access when accesses are a line or more apart.
+ */
+static size_t bytes_per_pass(size_t bytes, size_t stride) {
+	size_t line_longs = 64 / sizeof(long);
+	return stride < line_longs ? bytes : bytes / sizeof(long) / stride * 64;
+}
+
+double read_bandwidth(size_t bytes, size_t stride) {
+	size_t count = bytes / sizeof(long);
+	vector<long> xs(count, 1);
+	size_t moved = bytes_per_pass(bytes, stride);
+	size_t passes = max(bandwidth_traffic / moved, (size_t) 1);
+
+	double seconds = time_seconds([&] {
+		for (size_t pass = 0; pass < passes; pass++) {
+			long sum = 0;
+			for (size_t i = 0; i < count; i += stride) {
+				sum += xs[i];
+			}
+			do_not_optimize(sum);
+		}
+	});
+	return (double) moved * passes / seconds;
+}
+
+double write_bandwidth(size_t bytes, size_t stride) {
+	size_t count = bytes / sizeof(long);
+	vector<long> xs(count);
+	size_t moved = bytes_per_pass(bytes, stride);
+	size_t passes = max(bandwidth_traffic / moved, (size_t) 1);
+
+	double seconds = time_seconds([&] {
+		for (size_t pass = 0; pass < passes; pass++) {
+			long* p = xs.data();
+			for (size_t i = 0; i < count; i += stride) {
+				p[i] = (long) pass;
+			}
+			do_not_optimize(p[0]);
+		}
+	});
+	return (double) moved * passes / seconds;
+}
+
+/**
+ * Prints a size in bytes using the largest unit that fits.
+ */
+static void print_size(size_t bytes) {
+	if (bytes >= (1 << 30)) {
+		printf("%6zu GB", bytes >> 30);
+	} else if (bytes >= (1 << 20)) {
+		printf("%6zu MB", bytes >> 20);
+	} else {
+		printf("%6zu KB", bytes >> 10);
+	}
+}
+
+void print_memory_profile(size_t min_bytes, size_t max_bytes) {
+	size_t stride = 64 / sizeof(long);
+	printf("%9s %12s %16s %16s %18s %18s\n", "size", "latency ns",
+			"seq read GB/s", "seq write GB/s", "stride read GB/s",
+			"stride write GB/s");
+	for (size_t bytes = min_bytes; bytes <= max_bytes; bytes *= 2) {
+		print_size(bytes);
+		printf(" %12.2f", chase_latency_ns(bytes));
+		printf(" %16.2f", read_bandwidth(bytes, 1) / 1e9);
+		printf(" %16.2f", write_bandwidth(bytes, 1) / 1e9);
+		printf(" %18.2f", read_bandwidth(bytes, stride) / 1e9);
+		printf(" %18.2f\n", write_bandwidth(bytes, stride) / 1e9);
+		fflush(stdout);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef MEMORY_PROBE_H_
+#define MEMORY_PROBE_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Returns a random order in which to visit count nodes, starting at node 0,
+ * such that following it visits every node exactly once before going back
+ * to node 0. That is, next[i] is the node visited after node i.
+ */
+std::vector<size_t> make_chase_order(size_t count, unsigned seed);
+
+/**
+ * Returns the average number of nanoseconds a load takes when each load
+ * depends on the previous one, over a working set of the given bytes.
+ *
+ * Because the order is random, the hardware prefetcher can not guess the
+ * next address, so this is the load-to-use latency of the cache level (or
+ * main memory) the working set fits in.
+ */
+double chase_latency_ns(size_t bytes);
+
+/**
+ * Returns the bytes per second read by loading one long every stride longs
+ * from a working set of the given bytes.
+ *
+ * Since memory is moved in cache lines, the bytes of every cache line
+ * touched are counted, not only the bytes of the longs that were read.
+ */
+double read_bandwidth(size_t bytes, size_t stride);
+
+/**
+ * Returns the bytes per second written by storing one long every stride
+ * longs into a working set of the given bytes.
+ *
+ * As for reads, the bytes of every cache line touched are counted: a store
+ * to part of a line still has to read the whole line and write it back.
+ */
+double write_bandwidth(size_t bytes, size_t stride);
+
+/**
+ * Prints the latency, and the sequential and one line stride read and
+ * write bandwidth, of working sets from min_bytes to max_bytes, doubling
+ * the size on every row.
+ */
+void print_memory_profile(size_t min_bytes, size_t max_bytes);
+
+#endif /* MEMORY_PROBE_H_ */
@@ -0,0 +1,50 @@
+#include <cassert>
+#include <vector>
+#include "memory_probe.h"
+#include "memory_probe_tests.h"
+
+using namespace std;
+
+/**
+ * Tests that a chase order is a single cycle through all nodes.
+ *
+ * If the order had more than one cycle, a chase would only ever visit the
+ * nodes of the cycle it started in and the working set would be smaller
+ * than intended.
+ */
+void test_chase_order(void) {
+	const size_t count = 1000;
+	vector<size_t> next = make_chase_order(count, 1);
+	vector<bool> visited(count, false);
+
+	size_t node = 0;
+	for (size_t i = 0; i < count; i++) {
+		assert(!visited[node]);
+		visited[node] = true;
+		node = next[node];
+	}
+	assert(node == 0);
+
+	// A chain of a single node points to itself
+	assert(make_chase_order(1, 1)[0] == 0);
+}
+
+/**
+ * Tests that the probes measure something on a small working set.
+ */
+void test_probes(void) {
+	assert(chase_latency_ns(4096) > 0);
+	assert(read_bandwidth(4096, 1) > 0);
+	assert(read_bandwidth(4096, 8) > 0);
+	assert(write_bandwidth(4096, 1) > 0);
+	assert(write_bandwidth(4096, 8) > 0);
+}
+
+void run_memory_probe_tests(void) {
+	test_chase_order();
+	test_probes();
+}
+
+void run_memory_probe_benchmarks(void) {
+	print_memory_profile(4 << 10, 1 << 30);
+}
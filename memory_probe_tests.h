@@ -0,0 +1,7 @@
+#ifndef MEMORY_PROBE_TESTS_H_
+#define MEMORY_PROBE_TESTS_H_
+
+void run_memory_probe_tests(void);
+void run_memory_probe_benchmarks(void);
+
+#endif /* MEMORY_PROBE_TESTS_H_ */
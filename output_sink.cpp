@@ -0,0 +1,151 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+#include <unistd.h>
+#include "output_sink.h"
+
+using namespace std;
+
+/**
+ * Writes all n bytes, returning 0 or the error of the write that failed.
+ */
+static int write_all(int fd, const char* data, size_t n) {
+	while (n > 0) {
+		ssize_t written = ::write(fd, data, n);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno;
+		}
+		data += written;
+		n -= written;
+	}
+	return 0;
+}
+
+OutputSink::OutputSink(int fd, size_t buffer_size, bool background,
+		size_t max_buffers) :
+		fd(fd), capacity(buffer_size), background(background), max_chunks(
+				max_buffers), chunk_count(1), writing(false), stopping(false), error(
+				0) {
+	// Room for the longest number
+	assert(buffer_size >= 32);
+	assert(max_buffers >= 2);
+	current.data.reset(new char[capacity]);
+	if (background) {
+		writer = thread(&OutputSink::write_loop, this);
+	}
+}
+
+OutputSink::~OutputSink() {
+	try {
+		flush();
+	} catch (const system_error&) {
+	}
+	if (background) {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		work.notify_one();
+		writer.join();
+	}
+}
+
+void OutputSink::write_loop() {
+	unique_lock<mutex> guard(lock);
+	for (;;) {
+		work.wait(guard, [&] {
+			return !full.empty() || stopping;
+		});
+		if (full.empty()) {
+			return;
+		}
+		Chunk chunk = std::move(full.front());
+		full.pop_front();
+		writing = true;
+		guard.unlock();
+		int result = write_all(fd, chunk.data.get(), chunk.size);
+		guard.lock();
+		writing = false;
+		if (result && !error) {
+			error = result;
+		}
+		chunk.size = 0;
+		spare.push_back(std::move(chunk));
+		written.notify_one();
+	}
+}
+
+void OutputSink::submit() {
+	if (current.size == 0) {
+		return;
+	}
+	// Keeps the order with what was printed through stdio before
+	if (fd == STDOUT_FILENO) {
+		fflush(stdout);
+	}
+	if (!background) {
+		int result = write_all(fd, current.data.get(), current.size);
+		current.size = 0;
+		if (result) {
+			throw system_error(result, generic_category(), "write");
+		}
+		return;
+	}
+
+	unique_lock<mutex> guard(lock);
+	full.push_back(std::move(current));
+	work.notify_one();
+	if (spare.empty() && chunk_count < max_chunks) {
+		chunk_count++;
+		current.data.reset(new char[capacity]);
+		current.size = 0;
+		return;
+	}
+	written.wait(guard, [&] {
+		return !spare.empty();
+	});
+	current = std::move(spare.back());
+	spare.pop_back();
+}
+
+void OutputSink::write_slow(const char* s, size_t n) {
+	// Fills the buffer first, so that output stays in order
+	size_t room = capacity - current.size;
+	memcpy(current.data.get() + current.size, s, room);
+	current.size += room;
+	s += room;
+	n -= room;
+	while (n > 0) {
+		submit();
+		size_t part = n < capacity ? n : capacity;
+		memcpy(current.data.get(), s, part);
+		current.size = part;
+		s += part;
+		n -= part;
+	}
+}
+
+void OutputSink::flush() {
+	submit();
+	if (!background) {
+		return;
+	}
+	unique_lock<mutex> guard(lock);
+	written.wait(guard, [&] {
+		return full.empty() && !writing;
+	});
+	if (error) {
+		int result = error;
+		error = 0;
+		throw system_error(result, generic_category(), "write");
+	}
+}
+
+OutputSink& standard_output() {
+	static OutputSink sink(STDOUT_FILENO);
+	return sink;
+}
@@ -0,0 +1,145 @@
+#ifndef OUTPUT_SINK_H_
+#define OUTPUT_SINK_H_
+
+#include <charconv>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+ * Numbers written by 'OutputSink' as text, which are all integers and
+ * floating point numbers except characters and booleans.
+ */
+template<class T>
+concept SinkNumber = (std::integral<T> || std::floating_point<T>)
+		&& !std::same_as<T, char> && !std::same_as<T, bool>;
+
+/**
+ * Buffered output to a file descriptor, which only writes when its buffer
+ * is full or when it is flushed.
+ *
+ * Unlike 'std::endl', a line break does not flush, and numbers are
+ * formatted with 'std::to_chars' straight into the buffer, without locale
+ * or allocation. The buffer is reused, so writing never allocates.
+ *
+ * With a background writer, a full buffer is handed to a thread that makes
+ * the write system call, while the producer goes on in a spare buffer. The
+ * producer only waits if all buffers are still being written.
+ *
+ * A sink is meant for a single producer thread. It writes to the file
+ * descriptor directly, so output written through stdio or iostreams before
+ * it must be flushed first, except that a sink on the standard output
+ * flushes 'stdout' before each write. Errors of writes throw
+ * 'std::system_error', in the background case from the next flush.
+ */
+class OutputSink {
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t size = 0;
+	};
+
+	int fd;
+	size_t capacity;
+	Chunk current;
+
+	// Only used with a background writer
+	bool background;
+	size_t max_chunks;
+	size_t chunk_count;
+	std::mutex lock;
+	std::condition_variable work;
+	std::condition_variable written;
+	std::deque<Chunk> full;
+	std::vector<Chunk> spare;
+	bool writing;
+	bool stopping;
+	int error;
+	std::thread writer;
+
+	void write_loop();
+	void submit();
+	void write_slow(const char* s, size_t n);
+
+	void reserve(size_t n) {
+		if (capacity - current.size < n) {
+			submit();
+		}
+	}
+public:
+	/**
+	 * Creates a sink writing to fd, with buffers of buffer_size bytes. With
+	 * a background writer, up to max_buffers buffers are used.
+	 */
+	explicit OutputSink(int fd, size_t buffer_size = 1 << 16, bool background =
+			false, size_t max_buffers = 4);
+
+	/**
+	 * Flushes, ignoring errors, and stops the background writer.
+	 */
+	~OutputSink();
+
+	OutputSink(const OutputSink&) = delete;
+	OutputSink& operator=(const OutputSink&) = delete;
+
+	/**
+	 * Writes everything buffered so far, and waits until it is written.
+	 */
+	void flush();
+
+	OutputSink& write(const char* s, size_t n) {
+		if (n > capacity - current.size) {
+			write_slow(s, n);
+		} else {
+			memcpy(current.data.get() + current.size, s, n);
+			current.size += n;
+		}
+		return *this;
+	}
+
+	OutputSink& operator<<(std::string_view s) {
+		return write(s.data(), s.size());
+	}
+
+	OutputSink& operator<<(const char* s) {
+		return write(s, strlen(s));
+	}
+
+	OutputSink& operator<<(char c) {
+		reserve(1);
+		current.data[current.size++] = c;
+		return *this;
+	}
+
+	/**
+	 * Writes a number. Floating point numbers are written with the fewest
+	 * digits that read back as the same number.
+	 */
+	template<SinkNumber T>
+	OutputSink& operator<<(T value) {
+		// Enough for any 64 bit integer and any double
+		reserve(32);
+		char* p = current.data.get();
+		auto result = std::to_chars(p + current.size, p + capacity, value);
+		if (result.ec != std::errc()) {
+			throw std::system_error(std::make_error_code(result.ec),
+					"to_chars");
+		}
+		current.size = result.ptr - p;
+		return *this;
+	}
+};
+
+/**
+ * Returns a sink writing to the standard output, flushed at exit.
+ */
+OutputSink& standard_output();
+
+#endif /* OUTPUT_SINK_H_ */
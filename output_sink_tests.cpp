@@ -0,0 +1,197 @@
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "benchmark.h"
+#include "output_sink.h"
+#include "output_sink_tests.h"
+
+using namespace std;
+
+/**
+ * Returns the contents of a file, from its start.
+ */
+static string read_all(FILE* file) {
+	fflush(file);
+	rewind(file);
+	string text;
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		text.append(buffer, n);
+	}
+	return text;
+}
+
+/**
+ * Tests that numbers and strings are written as they would be by a stream,
+ * and only once the sink is flushed.
+ */
+void test_output_sink(void) {
+	FILE* file = tmpfile();
+	assert(file);
+	{
+		OutputSink out(fileno(file));
+		out << "int " << 42 << ' ' << -7 << ' ' << INT_MIN << '\n';
+		out << "long " << LLONG_MAX << ' ' << 18446744073709551615ull << '\n';
+		out << "double " << 0.5 << ' ' << 0.1 << ' ' << -1e300 << '\n';
+
+		// Nothing is written yet
+		assert(read_all(file).empty());
+		out.flush();
+		assert(read_all(file) == "int 42 -7 -2147483648\n"
+				"long 9223372036854775807 18446744073709551615\n"
+				"double 0.5 0.1 -1e+300\n");
+
+		// The destructor flushes
+		out << string_view("last");
+	}
+	assert(read_all(file).substr(read_all(file).size() - 4) == "last");
+	fclose(file);
+}
+
+/**
+ * Tests writing much more than a buffer holds, with and without a
+ * background writer, including strings longer than the buffer.
+ */
+void test_output_sink_overflow(void) {
+	for (bool background : { false, true }) {
+		FILE* file = tmpfile();
+		assert(file);
+		string expected;
+		{
+			OutputSink out(fileno(file), 64, background, 2);
+			for (int i = 0; i < 10000; i++) {
+				out << i << '\n';
+				expected += to_string(i) + '\n';
+			}
+			string line(1000, 'x');
+			out << line;
+			expected += line;
+			out << 3.25;
+			expected += "3.25";
+			out.flush();
+			assert(read_all(file) == expected);
+		}
+		fclose(file);
+	}
+}
+
+/**
+ * Tests that a failed write is reported when flushing.
+ */
+void test_output_sink_error(void) {
+	for (bool background : { false, true }) {
+		int fd = open("/dev/null", O_RDONLY);
+		assert(fd >= 0);
+		bool thrown = false;
+		{
+			OutputSink out(fd, 64, background);
+			out << "not writable";
+			try {
+				out.flush();
+			} catch (const system_error&) {
+				thrown = true;
+			}
+		}
+		assert(thrown);
+		close(fd);
+	}
+}
+
+/**
+ * Tests that a sink on the standard output keeps the order with what was
+ * printed through stdio before.
+ */
+void test_output_sink_stdout_order(void) {
+	FILE* file = tmpfile();
+	assert(file);
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	assert(saved >= 0);
+	assert(dup2(fileno(file), STDOUT_FILENO) >= 0);
+	{
+		OutputSink out(STDOUT_FILENO);
+		printf("first\n");
+		out << "second\n";
+		out.flush();
+		printf("third\n");
+		fflush(stdout);
+	}
+	assert(dup2(saved, STDOUT_FILENO) >= 0);
+	close(saved);
+	assert(read_all(file) == "first\nsecond\nthird\n");
+	fclose(file);
+}
+
+void run_output_sink_tests(void) {
+	test_output_sink();
+	test_output_sink_overflow();
+	test_output_sink_error();
+	test_output_sink_stdout_order();
+}
+
+/**
+ * Compares ways of writing lines of text and numbers to /dev/null, which
+ * measures formatting and system calls without any device in the way.
+ *
+ * The standard output is redirected while iostreams and stdio are measured.
+ */
+void bench_output_sink(void) {
+	const int lines = 1 << 20;
+	int null = open("/dev/null", O_WRONLY);
+	assert(null >= 0);
+	fflush(stdout);
+	cout.flush();
+	int saved = dup(STDOUT_FILENO);
+	dup2(null, STDOUT_FILENO);
+
+	double endl_seconds = time_seconds([&] {
+		for (int i = 0; i < lines; i++) {
+			cout << "line " << i << ' ' << i * 0.5 << endl;
+		}
+	});
+	double newline_seconds = time_seconds([&] {
+		for (int i = 0; i < lines; i++) {
+			cout << "line " << i << ' ' << i * 0.5 << '\n';
+		}
+		cout.flush();
+	});
+	double printf_seconds = time_seconds([&] {
+		for (int i = 0; i < lines; i++) {
+			printf("line %d %g\n", i, i * 0.5);
+		}
+		fflush(stdout);
+	});
+
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	double sink_seconds = time_seconds([&] {
+		OutputSink out(null);
+		for (int i = 0; i < lines; i++) {
+			out << "line " << i << ' ' << i * 0.5 << '\n';
+		}
+	});
+	double background_seconds = time_seconds([&] {
+		OutputSink out(null, 1 << 16, true);
+		for (int i = 0; i < lines; i++) {
+			out << "line " << i << ' ' << i * 0.5 << '\n';
+		}
+	});
+	close(null);
+
+	print_rate("cout << endl", lines, endl_seconds, "lines");
+	print_rate("cout << '\\n'", lines, newline_seconds, "lines");
+	print_rate("printf", lines, printf_seconds, "lines");
+	print_rate("OutputSink", lines, sink_seconds, "lines");
+	print_rate("OutputSink (background writer)", lines, background_seconds,
+			"lines");
+}
+
+void run_output_sink_benchmarks(void) {
+	bench_output_sink();
+}
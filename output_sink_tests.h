@@ -0,0 +1,7 @@
+#ifndef OUTPUT_SINK_TESTS_H_
+#define OUTPUT_SINK_TESTS_H_
+
+void run_output_sink_tests(void);
+void run_output_sink_benchmarks(void);
+
+#endif /* OUTPUT_SINK_TESTS_H_ */
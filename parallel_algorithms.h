@@ -0,0 +1,229 @@
+#ifndef PARALLEL_ALGORITHMS_H_
+#define PARALLEL_ALGORITHMS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "thread_pool.h"
+
+/**
+ * Default number of elements a thread works on at a time. Every grain must
+ * be at least one element.
+ */
+constexpr size_t default_grain = 1 << 16;
+
+/**
+ * Returns op applied to init and all n elements of data.
+ *
+ * Each chunk is reduced on its own and the partial results are then
+ * combined in order, so op must be associative but need not be commutative.
+ */
+template<class T, class Op = std::plus<T>>
+T parallel_reduce(const T* data, size_t n, T init, Op op = Op(),
+		size_t grain = default_grain, ThreadPool& pool = shared_pool()) {
+	assert(grain >= 1);
+	size_t chunks = (n + grain - 1) / grain;
+	std::vector<T> partials(chunks);
+	pool.parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+		for (size_t c = first; c < last; c++) {
+			const T* p = data + c * grain;
+			const T* end = data + std::min((c + 1) * grain, n);
+			T sum = *p++;
+			for (; p < end; p++) {
+				sum = op(sum, *p);
+			}
+			partials[c] = sum;
+		}
+	});
+	for (const T& partial : partials) {
+		init = op(init, partial);
+	}
+	return init;
+}
+
+/**
+ * Writes to out the inclusive prefix sums of the n elements of in, that is,
+ * out[i] = in[0] + ... + in[i]. The input and output may be the same.
+ *
+ * First each chunk is summed in parallel, then the sums of the chunks are
+ * scanned, and finally each chunk is scanned in parallel starting from the
+ * sum of the chunks before it.
+ */
+template<class T>
+void parallel_prefix_sum(const T* in, T* out, size_t n, size_t grain =
+		default_grain, ThreadPool& pool = shared_pool()) {
+	assert(grain >= 1);
+	size_t chunks = (n + grain - 1) / grain;
+	std::vector<T> offsets(chunks);
+	pool.parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+		for (size_t c = first; c < last; c++) {
+			T sum = T();
+			for (size_t i = c * grain; i < std::min((c + 1) * grain, n); i++) {
+				sum += in[i];
+			}
+			offsets[c] = sum;
+		}
+	});
+	T total = T();
+	for (T& offset : offsets) {
+		T sum = offset;
+		offset = total;
+		total += sum;
+	}
+	pool.parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+		for (size_t c = first; c < last; c++) {
+			T sum = offsets[c];
+			for (size_t i = c * grain; i < std::min((c + 1) * grain, n); i++) {
+				sum += in[i];
+				out[i] = sum;
+			}
+		}
+	});
+}
+
+/**
+ * Sorts n integers with a least significant digit radix sort, one byte at a
+ * time.
+ *
+ * Every pass counts the digits of each chunk in parallel, works out where
+ * each chunk writes each digit, and then moves the elements in parallel to
+ * a buffer of the same size. Passes in which every element has the same
+ * digit are skipped.
+ */
+template<class T>
+void parallel_radix_sort(T* data, size_t n, size_t grain = default_grain,
+		ThreadPool& pool = shared_pool()) {
+	static_assert(std::is_integral<T>::value, "only integers have digits");
+	assert(grain >= 1);
+	using U = typename std::make_unsigned<T>::type;
+	// Flipping the sign bit sorts negative numbers before positive ones
+	const U flip = std::is_signed<T>::value ? (U) 1 << (sizeof(T) * 8 - 1) : 0;
+
+	size_t chunks = (n + grain - 1) / grain;
+	std::vector<T> buffer(n);
+	std::vector<size_t> counts(chunks * 256);
+	T* from = data;
+	T* to = buffer.data();
+
+	for (size_t shift = 0; shift < sizeof(T) * 8; shift += 8) {
+		auto digit = [&](T x) {
+			return (((U) x ^ flip) >> shift) & 0xff;
+		};
+		std::fill(counts.begin(), counts.end(), 0);
+		pool.parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+			for (size_t c = first; c < last; c++) {
+				size_t* count = &counts[c * 256];
+				for (size_t i = c * grain; i < std::min((c + 1) * grain, n); i++) {
+					count[digit(from[i])]++;
+				}
+			}
+		});
+
+		// Each digit goes after all smaller digits, and for the same digit,
+		// earlier chunks go first, which keeps the sort stable
+		size_t offset = 0;
+		bool skip = false;
+		for (size_t d = 0; d < 256; d++) {
+			size_t total = 0;
+			for (size_t c = 0; c < chunks; c++) {
+				size_t count = counts[c * 256 + d];
+				counts[c * 256 + d] = offset + total;
+				total += count;
+			}
+			skip = skip || total == n;
+			offset += total;
+		}
+		if (skip) {
+			continue;
+		}
+
+		pool.parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+			for (size_t c = first; c < last; c++) {
+				size_t* next = &counts[c * 256];
+				for (size_t i = c * grain; i < std::min((c + 1) * grain, n); i++) {
+					to[next[digit(from[i])]++] = from[i];
+				}
+			}
+		});
+		std::swap(from, to);
+	}
+	if (from != data) {
+		std::copy(from, from + n, data);
+	}
+}
+
+/**
+ * Returns how many elements of a come before position d of the merge of a
+ * and b, where the merge takes from a first when elements are equal.
+ */
+template<class T, class Compare>
+size_t merge_split(const T* a, size_t na, const T* b, size_t nb, size_t d,
+		Compare comp) {
+	size_t low = d > nb ? d - nb : 0;
+	size_t high = std::min(d, na);
+	while (low < high) {
+		size_t i = low + (high - low) / 2;
+		// Too few taken from a if a[i] does not come after b[d - i - 1]
+		if (!comp(b[d - i - 1], a[i])) {
+			low = i + 1;
+		} else {
+			high = i;
+		}
+	}
+	return low;
+}
+
+/**
+ * Sorts n elements with a merge sort.
+ *
+ * Chunks are sorted in parallel, then pairs of sorted runs are merged until
+ * one run is left. Every merge is split in pieces of about grain elements,
+ * by finding where each piece starts in both runs, so even the last merge
+ * runs in parallel. Like 'std::stable_sort', equal elements keep their
+ * order.
+ */
+template<class T, class Compare = std::less<T>>
+void parallel_merge_sort(T* data, size_t n, Compare comp = Compare(),
+		size_t grain = default_grain, ThreadPool& pool = shared_pool()) {
+	assert(grain >= 1);
+	pool.parallel_for(0, n, grain, [&](size_t first, size_t last) {
+		std::stable_sort(data + first, data + last, comp);
+	});
+
+	std::vector<T> buffer(n);
+	T* from = data;
+	T* to = buffer.data();
+	for (size_t run = grain; run < n; run *= 2) {
+		pool.parallel_for(0, (n + grain - 1) / grain, 1,
+				[&](size_t first, size_t last) {
+					for (size_t piece = first; piece < last; piece++) {
+						// The piece is part of the merge of the pair of runs
+						// that starts at pair
+						size_t out = piece * grain;
+						size_t pair = out / (2 * run) * (2 * run);
+						const T* a = from + pair;
+						size_t na = std::min(run, n - pair);
+						const T* b = a + na;
+						size_t nb = std::min(run, n - pair - na);
+						size_t d = out - pair;
+						size_t e = std::min(d + grain, na + nb);
+						size_t i = merge_split(a, na, b, nb, d, comp);
+						size_t j = d - i;
+						size_t i_end = merge_split(a, na, b, nb, e, comp);
+						size_t j_end = e - i_end;
+						std::merge(a + i, a + i_end, b + j, b + j_end,
+								to + out, comp);
+					}
+				});
+		std::swap(from, to);
+	}
+	if (from != data) {
+		std::copy(from, from + n, data);
+	}
+}
+
+#endif /* PARALLEL_ALGORITHMS_H_ */
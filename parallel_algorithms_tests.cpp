@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "benchmark.h"
+#include "parallel_algorithms.h"
+#include "parallel_algorithms_tests.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * Returns n random numbers, positive and negative.
+ */
+template<class T>
+vector<T> random_values(size_t n, unsigned seed) {
+	mt19937_64 random(seed);
+	vector<T> values(n);
+	for (T& value : values) {
+		value = (T) (long) random();
+	}
+	return values;
+}
+
+/**
+ * Tests that a loop visits every index exactly once, including nested
+ * loops.
+ */
+void test_parallel_for(void) {
+	ThreadPool pool(3);
+	vector<atomic<int>> visits(1000);
+	pool.parallel_for(0, 1000, 7, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			visits[i]++;
+		}
+	});
+	pool.parallel_for(5, 5, 1, [&](size_t, size_t) {
+		assert(false);
+	});
+	for (atomic<int>& v : visits) {
+		assert(v == 1);
+	}
+
+	atomic<int> inner(0);
+	pool.parallel_for(0, 8, 1, [&](size_t, size_t) {
+		pool.parallel_for(0, 8, 1, [&](size_t, size_t) {
+			inner++;
+		});
+	});
+	assert(inner == 64);
+}
+
+/**
+ * Tests reduce and prefix sum against std::accumulate and std::partial_sum.
+ */
+void test_parallel_scan_reduce(void) {
+	ThreadPool pool(3);
+	const size_t sizes[] = { 0, 1, 1000, 100003 };
+	for (size_t n : sizes) {
+		vector<long> xs = random_values<long>(n, n);
+		for (long& x : xs) {
+			x %= 1000;
+		}
+		assert(parallel_reduce(xs.data(), n, 0L, plus<long>(), 1000, pool)
+				== accumulate(xs.begin(), xs.end(), 0L));
+		assert(parallel_reduce(xs.data(), n, LONG_MIN,
+				[](long a, long b) { return max(a, b); }, 1000, pool)
+				== accumulate(xs.begin(), xs.end(), LONG_MIN,
+						[](long a, long b) { return max(a, b); }));
+
+		vector<long> expected(n);
+		partial_sum(xs.begin(), xs.end(), expected.begin());
+		parallel_prefix_sum(xs.data(), xs.data(), n, 1000, pool);
+		assert(xs == expected);
+
+		// Floating point sums differ by rounding only, since the order of
+		// the additions changes
+		vector<double> ds(n);
+		for (size_t i = 0; i < n; i++) {
+			ds[i] = i * 0.5;
+		}
+		double sum = parallel_reduce(ds.data(), n, 0.0, plus<double>(), 1000,
+				pool);
+		assert(fabs(sum - accumulate(ds.begin(), ds.end(), 0.0)) <= 1e-9 * sum);
+	}
+}
+
+/**
+ * Tests the sorts against std::sort.
+ */
+void test_parallel_sorts(void) {
+	ThreadPool pool(3);
+	const size_t sizes[] = { 0, 1, 2, 1000, 100003 };
+	for (size_t n : sizes) {
+		vector<int> is = random_values<int>(n, n);
+		vector<int> sorted_is = is;
+		sort(sorted_is.begin(), sorted_is.end());
+		parallel_radix_sort(is.data(), n, 1000, pool);
+		assert(is == sorted_is);
+
+		vector<long> ls = random_values<long>(n, n + 1);
+		vector<long> sorted_ls = ls;
+		sort(sorted_ls.begin(), sorted_ls.end());
+		parallel_radix_sort(ls.data(), n, 1000, pool);
+		assert(ls == sorted_ls);
+
+		vector<double> ds = random_values<double>(n, n + 2);
+		vector<double> sorted_ds = ds;
+		sort(sorted_ds.begin(), sorted_ds.end());
+		parallel_merge_sort(ds.data(), n, less<double>(), 1000, pool);
+		assert(ds == sorted_ds);
+	}
+
+	// Small numbers only differ in their lowest byte, so most radix passes
+	// are skipped
+	vector<unsigned long> small = { 3, 1, 2, 0, 255, 7 };
+	parallel_radix_sort(small.data(), small.size(), 2, pool);
+	assert(is_sorted(small.begin(), small.end()));
+
+	// The merge sort is stable: equal elements keep their order
+	vector<pair<int, int>> ps(10000);
+	for (int i = 0; i < 10000; i++) {
+		ps[i] = { i % 10, i };
+	}
+	auto by_first = [](const pair<int, int>& a, const pair<int, int>& b) {
+		return a.first < b.first;
+	};
+	vector<pair<int, int>> expected = ps;
+	stable_sort(expected.begin(), expected.end(), by_first);
+	parallel_merge_sort(ps.data(), ps.size(), by_first, 100, pool);
+	assert(ps == expected);
+}
+
+void run_parallel_algorithms_tests(void) {
+	test_parallel_for();
+	test_parallel_scan_reduce();
+	test_parallel_sorts();
+}
+
+/**
+ * Runs the algorithms on n elements with pools of 1 thread up to a thread
+ * per core, printing the elements per second.
+ */
+void bench_scaling(size_t n) {
+	size_t cores = max(thread::hardware_concurrency(), 1u);
+	vector<int> is = random_values<int>(n, 1);
+	vector<long> ls = random_values<long>(n, 2);
+	// Small enough that the sum does not overflow
+	for (long& l : ls) {
+		l %= 1000;
+	}
+	vector<double> ds = random_values<double>(n, 3);
+	vector<int> work(n);
+	vector<double> dwork(n);
+
+	for (size_t threads = 1; threads <= cores;
+			threads = threads < cores && threads * 2 > cores ?
+					cores : threads * 2) {
+		ThreadPool pool(threads - 1);
+		char label[64];
+
+		double seconds = time_seconds([&] {
+			do_not_optimize(parallel_reduce(ls.data(), n, 0L, plus<long>(),
+					default_grain, pool));
+		});
+		snprintf(label, sizeof(label), "reduce long %zu, %zu threads", n,
+				threads);
+		print_rate(label, n, seconds, "elems");
+
+		seconds = time_seconds([&] {
+			parallel_prefix_sum(ds.data(), dwork.data(), n, default_grain, pool);
+		});
+		snprintf(label, sizeof(label), "prefix sum double %zu, %zu threads", n,
+				threads);
+		print_rate(label, n, seconds, "elems");
+
+		copy(is.begin(), is.end(), work.begin());
+		seconds = time_seconds([&] {
+			parallel_radix_sort(work.data(), n, default_grain, pool);
+		});
+		snprintf(label, sizeof(label), "radix sort int %zu, %zu threads", n,
+				threads);
+		print_rate(label, n, seconds, "elems");
+
+		copy(ds.begin(), ds.end(), dwork.begin());
+		seconds = time_seconds([&] {
+			parallel_merge_sort(dwork.data(), n, less<double>(), default_grain,
+					pool);
+		});
+		snprintf(label, sizeof(label), "merge sort double %zu, %zu threads", n,
+				threads);
+		print_rate(label, n, seconds, "elems");
+	}
+
+	copy(is.begin(), is.end(), work.begin());
+	double seconds = time_seconds([&] {
+		sort(work.begin(), work.end());
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "std::sort int %zu", n);
+	print_rate(label, n, seconds, "elems");
+}
+
+void run_parallel_algorithms_benchmarks(void) {
+	// A billion elements take 8 GB per array of longs or doubles, and the
+	// benchmark keeps several, so it only runs on hosts with enough memory
+	size_t memory = (size_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+	size_t max_n = memory >= (size_t) 64 << 30 ? 1000000000 : 100000000;
+	for (size_t n = 10000000; n <= max_n; n *= 10) {
+		bench_scaling(n);
+	}
+}
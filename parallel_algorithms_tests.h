@@ -0,0 +1,7 @@
+#ifndef PARALLEL_ALGORITHMS_TESTS_H_
+#define PARALLEL_ALGORITHMS_TESTS_H_
+
+void run_parallel_algorithms_tests(void);
+void run_parallel_algorithms_benchmarks(void);
+
+#endif /* PARALLEL_ALGORITHMS_TESTS_H_ */
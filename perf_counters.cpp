@@ -0,0 +1,176 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+using namespace std;
+
+static const char* event_names[PerfEventCount] = { "cycles", "instructions",
+		"L1D misses", "LLC misses", "branch misses", "dTLB misses" };
+
+/**
+ * Fills the type and config of the perf_event_attr of an event.
+ */
+static void describe_event(PerfEvent event, perf_event_attr& attr) {
+	const uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8
+			| PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+	switch (event) {
+	case Cycles:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case Instructions:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case L1dMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+		break;
+	case LlcMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case BranchMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case DtlbMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Returns a message explaining why perf_event_open failed with the given
+ * error.
+ */
+static string explain(int error) {
+	if (error == EACCES || error == EPERM) {
+		int paranoid = -1;
+		FILE* file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+		if (file) {
+			if (fscanf(file, "%d", &paranoid) != 1) {
+				paranoid = -1;
+			}
+			fclose(file);
+		}
+		return "not permitted (perf_event_paranoid is " + to_string(paranoid)
+				+ "); lower it or grant CAP_PERFMON";
+	}
+	if (error == ENOENT || error == EOPNOTSUPP || error == ENODEV) {
+		return "event not supported; this may be a container or virtual "
+				"machine without hardware counters";
+	}
+	if (error == ENOSYS) {
+		return "perf_event_open is not available on this kernel";
+	}
+	return string("perf_event_open failed: ") + strerror(error);
+}
+
+PerfCounters::PerfCounters() {
+	for (int e = 0; e < PerfEventCount; e++) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		describe_event((PerfEvent) e, attr);
+		attr.disabled = 1;
+		// Only this process in user space, which needs the least privilege
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// Threads started while counting are counted too. Counts of
+		// inherited events can not be read as a group, so each is read alone
+		attr.inherit = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+				| PERF_FORMAT_TOTAL_TIME_RUNNING;
+		// Instructions are in the group of cycles, so both are always
+		// scheduled together and their ratio is from the same intervals
+		int group = e == Instructions ? fds[Cycles] : -1;
+		fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+		if (fds[e] < 0 && reason.empty()) {
+			reason = string(event_names[e]) + ": " + explain(errno);
+		}
+	}
+}
+
+PerfCounters::~PerfCounters() {
+	for (int fd : fds) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+}
+
+bool PerfCounters::available() const {
+	for (int fd : fds) {
+		if (fd >= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void PerfCounters::start() {
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void PerfCounters::stop() {
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+}
+
+PerfSample PerfCounters::read() const {
+	PerfSample sample;
+	for (int e = 0; e < PerfEventCount; e++) {
+		// The value, then the time enabled and the time running
+		uint64_t data[3];
+		if (fds[e] < 0 || ::read(fds[e], data, sizeof(data)) != sizeof(data)
+				|| data[2] == 0) {
+			continue;
+		}
+		sample.values[e] = (double) data[0] * data[1] / data[2];
+		sample.valid[e] = true;
+	}
+	return sample;
+}
+
+void print_perf_sample(const char* name, const PerfSample& sample,
+		double iterations, const string& error) {
+	static bool reported = false;
+	if (!error.empty() && !reported) {
+		printf("perf counters: %s\n", error.c_str());
+		reported = true;
+	}
+	printf("%-40s", name);
+	bool any = false;
+	for (int e = 0; e < PerfEventCount; e++) {
+		if (sample.valid[e]) {
+			printf(" %s %.1f", event_names[e], sample.values[e] / iterations);
+			any = true;
+		}
+	}
+	if (sample.valid[Cycles] && sample.valid[Instructions]
+			&& sample.values[Cycles] > 0) {
+		printf(" IPC %.2f", sample.values[Instructions] / sample.values[Cycles]);
+	}
+	if (!any) {
+		printf(" no counters available");
+	}
+	printf("\n");
+}
@@ -0,0 +1,103 @@
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <string>
+
+/**
+ * Hardware events counted by 'PerfCounters'.
+ */
+enum PerfEvent {
+	Cycles,
+	Instructions,
+	L1dMisses,
+	LlcMisses,
+	BranchMisses,
+	DtlbMisses,
+	PerfEventCount
+};
+
+/**
+ * Counts of hardware events over a measured interval. An event that could
+ * not be counted is marked as not valid.
+ */
+struct PerfSample {
+	double values[PerfEventCount] = { };
+	bool valid[PerfEventCount] = { };
+};
+
+/**
+ * Hardware performance counters of the calling thread, and of the threads
+ * it starts while counting, read with Linux's perf_event_open. Threads that
+ * were already running, such as those of a thread pool started earlier, are
+ * not counted.
+ *
+ * Counters are often unavailable: in containers and virtual machines that
+ * do not expose the hardware counters, when perf_event_paranoid forbids
+ * them, or on other systems. Counters that can not be opened are skipped
+ * and 'error' explains why, so measuring always works, even if it counts
+ * nothing.
+ */
+class PerfCounters {
+	int fds[PerfEventCount];
+	std::string reason;
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/**
+	 * Returns whether at least one event is being counted.
+	 */
+	bool available() const;
+
+	/**
+	 * Returns why some or all events can not be counted, or an empty string
+	 * if all can.
+	 */
+	const std::string& error() const {
+		return reason;
+	}
+
+	/**
+	 * Returns whether the event could be opened. An opened event may still
+	 * have no count, if the kernel never got to schedule it on the hardware.
+	 */
+	bool opened(PerfEvent event) const {
+		return fds[event] >= 0;
+	}
+
+	void start();
+	void stop();
+
+	/**
+	 * Returns the counts since the last start. If the kernel had to share
+	 * the hardware between more events than it has counters, counts are
+	 * scaled up to the whole interval, and an event that never ran is not
+	 * valid.
+	 */
+	PerfSample read() const;
+};
+
+/**
+ * Prints the counts of a sample divided by iterations, and the instructions
+ * per cycle. The first time some events are missing, also prints why.
+ */
+void print_perf_sample(const char* name, const PerfSample& sample,
+		double iterations, const std::string& error);
+
+/**
+ * Runs func while counting hardware events, then prints the counts per
+ * iteration, or why they could not be counted.
+ */
+template<class F>
+void measure(const char* name, double iterations, F func) {
+	PerfCounters counters;
+	counters.start();
+	func();
+	counters.stop();
+	print_perf_sample(name, counters.read(), iterations, counters.error());
+}
+
+#endif /* PERF_COUNTERS_H_ */
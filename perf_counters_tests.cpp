@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "perf_counters.h"
+#include "perf_counters_tests.h"
+
+using namespace std;
+
+/**
+ * Tests that counters either count or say why they can not.
+ */
+void test_perf_counters(void) {
+	PerfCounters counters;
+	assert(counters.available() || !counters.error().empty());
+
+	volatile long sum = 0;
+	counters.start();
+	for (long i = 0; i < 1000000; i++) {
+		sum = sum + i;
+	}
+	counters.stop();
+	PerfSample sample = counters.read();
+
+	// A million additions take at least a million instructions
+	if (sample.valid[Instructions]) {
+		assert(sample.values[Instructions] >= 1000000);
+	}
+	// An event that was opened may still have been multiplexed out for the
+	// whole interval on a busy host, but one that was not opened says why
+	for (int e = 0; e < PerfEventCount; e++) {
+		PerfEvent event = (PerfEvent) e;
+		assert(!sample.valid[e] || counters.opened(event));
+		assert(counters.opened(event) || !counters.error().empty());
+	}
+}
+
+void run_perf_counters_tests(void) {
+	test_perf_counters();
+}
+
+/**
+ * Counts the events of the same loop over sorted and shuffled data, and
+ * over data read in order and in a random order. Times alone only show
+ * that the second of each pair is slower; the branch and cache misses show
+ * why.
+ */
+void bench_perf_counters(void) {
+	const size_t count = 1 << 22;
+	vector<int> xs(count);
+	mt19937 random(42);
+	for (int& x : xs) {
+		x = random() % 256;
+	}
+	vector<int> sorted = xs;
+	sort(sorted.begin(), sorted.end());
+
+	auto sum_large = [](const vector<int>& v) {
+		long sum = 0;
+		for (int x : v) {
+			if (x >= 128) {
+				sum += x;
+			}
+		}
+		do_not_optimize(sum);
+	};
+	measure("branch on sorted data", count, [&] {
+		sum_large(sorted);
+	});
+	measure("branch on shuffled data", count, [&] {
+		sum_large(xs);
+	});
+
+	vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	auto sum_at = [&](const vector<size_t>& indices) {
+		long sum = 0;
+		for (size_t i : indices) {
+			sum += xs[i];
+		}
+		do_not_optimize(sum);
+	};
+	measure("sequential reads", count, [&] {
+		sum_at(order);
+	});
+	shuffle(order.begin(), order.end(), random);
+	measure("random reads", count, [&] {
+		sum_at(order);
+	});
+}
+
+void run_perf_counters_benchmarks(void) {
+	bench_perf_counters();
+}
@@ -0,0 +1,7 @@
+#ifndef PERF_COUNTERS_TESTS_H_
+#define PERF_COUNTERS_TESTS_H_
+
+void run_perf_counters_tests(void);
+void run_perf_counters_benchmarks(void);
+
+#endif /* PERF_COUNTERS_TESTS_H_ */
@@ -0,0 +1,67 @@
+#ifndef PERSON_INDEX_H_
+#define PERSON_INDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "btree.h"
+#include "data_structures.h"
+
+/**
+ * Returns the key of a person in an index by age.
+ *
+ * The age is in the high bits and the number of the person in the low
+ * bits, so persons of the same age have distinct keys, ordered by number.
+ */
+constexpr int64_t person_age_key(int age, uint32_t number) {
+	return (int64_t) age << 32 | number;
+}
+
+/**
+ * Index of persons by age, to find the persons in a range of ages.
+ *
+ * Persons are numbered by their position in the array the index is built
+ * from, and the index holds pointers to them, so the array must outlive it.
+ */
+class PersonIndex {
+	BPlusTree<const Person*> tree;
+public:
+	/**
+	 * Indexes the n persons of an array, replacing what was indexed.
+	 */
+	void build(const Person* persons, uint32_t n) {
+		std::vector<std::pair<int64_t, const Person*>> pairs(n);
+		for (uint32_t i = 0; i < n; i++) {
+			pairs[i] = {person_age_key(persons[i].age, i), &persons[i]};
+		}
+		std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+			return a.first < b.first;
+		});
+		tree.bulk_load(pairs.data(), n);
+	}
+
+	/**
+	 * Adds the person with the given number.
+	 */
+	void add(const Person& person, uint32_t number) {
+		tree.insert(person_age_key(person.age, number), &person);
+	}
+
+	/**
+	 * Calls func with every person whose age is in [low, high], by age.
+	 */
+	template<class F>
+	void for_ages(int low, int high, F func) const {
+		tree.for_range(person_age_key(low, 0), person_age_key(high + 1, 0),
+				[&](int64_t, const Person* person) {
+					func(*person);
+				});
+	}
+
+	size_t size() const {
+		return tree.size();
+	}
+};
+
+#endif /* PERSON_INDEX_H_ */
@@ -1,4 +1,5 @@
-#include <iostream>
+#include "output_sink.h"
+#include "ref_ptr.h"
 
 using namespace std;
 
@@ -14,7 +15,8 @@ A::A(int a) {
 }
 
 void A::print() {
-	cout << a << endl;
+	// Buffered, so printing many times does not make a system call each time
+	standard_output() << a << '\n';
 }
 
 template<class T>
@@ -23,8 +25,9 @@ void runCFunc(T* t, void (T::*func)(void)) {
 }
 
 void test() {
-	A* a = new A(1);
+	// Owned, so it is freed once the last pointer to it goes away
+	LocalShared<A> a = make_local_shared<A>(1);
 	a->print();
-	runCFunc(a, &A::print);
+	runCFunc(a.get(), &A::print);
 }
 
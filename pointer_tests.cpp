@@ -1,5 +1,9 @@
 #include <cassert>
 #include <cstring>
+#include <vector>
+#include "benchmark.h"
+#include "generic_increment.h"
+#include "pointer_tests.h"
 
 /**
  * Increments the value of the given pointer by one.
@@ -407,6 +411,55 @@ void test_void_pointer(void) {
 	assert(y == 'b');
 }
 
+/**
+ * Tests incrementing a whole untyped buffer at once.
+ *
+ * Instead of a size, the type of the elements is given so that the function
+ * knows both how to step through the buffer and how to increment each element.
+ */
+void test_generic_increment_n(void) {
+	char cs[] = { 'a', 'b', 'c' };
+	generic_increment_n(cs, ElemType::Int8, 3);
+	assert(cs[0] == 'b' && cs[2] == 'd');
+
+	short ss[] = { 1, 2, 3 };
+	generic_increment_n(ss, ElemType::Int16, 3);
+	assert(ss[0] == 2 && ss[2] == 4);
+
+	int is[] = { 1, 2, 3, 4, 5 };
+	generic_increment_n(is, ElemType::Int32, 4);
+	assert(is[0] == 2 && is[3] == 5);
+
+	// Only count elements are incremented
+	assert(is[4] == 5);
+
+	long ls[] = { 1, 2 };
+	generic_increment_n(ls, ElemType::Int64, 2);
+	assert(ls[0] == 2 && ls[1] == 3);
+
+	float fs[] = { 0.5f };
+	generic_increment_n(fs, ElemType::Float, 1);
+	assert(fs[0] == 1.5f);
+
+	double ds[] = { 0.5, 1.5 };
+	generic_increment_n(ds, ElemType::Double, 2);
+	assert(ds[0] == 1.5 && ds[1] == 2.5);
+
+	// Whole blocks and the elements after them
+	std::vector<int> many(200);
+	for (int i = 0; i < 200; i++) {
+		many[i] = i;
+	}
+	generic_increment_n(many.data(), ElemType::Int32, 199);
+	for (int i = 0; i < 199; i++) {
+		assert(many[i] == i + 1);
+	}
+	assert(many[199] == 199);
+
+	// Incrementing nothing is valid
+	generic_increment_n(nullptr, ElemType::Int32, 0);
+}
+
 /**
  * Tests invalid pointers.
  */
@@ -476,8 +529,57 @@ void run_pointer_tests(void) {
 	test_pointer_to_const();
 	test_pointer_to_pointer();
 	test_void_pointer();
+	test_generic_increment_n();
 	test_invalid_pointers();
 	test_null_pointers();
 	test_pointers_to_functions();
 }
 
+
+/**
+ * Compares incrementing a buffer one 'void*' element at a time with
+ * incrementing it in a single batched call.
+ */
+void bench_generic_increment(void) {
+	const size_t count = 1 << 20;
+	const int rounds = 200;
+	std::vector<int> xs(count);
+
+	// Called through a pointer so that, like a function from another library,
+	// it is neither inlined nor specialized for the constant size.
+	void (*volatile increment_elem)(void*, int) = generic_increment;
+
+	double per_elem = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			for (size_t i = 0; i < count; i++) {
+				increment_elem(&xs[i], sizeof(int));
+			}
+			do_not_optimize(xs[0]);
+		}
+	});
+	print_rate("generic_increment (int, per element)", (double) count * rounds,
+			per_elem, "elems");
+
+	double batched = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			generic_increment_n(xs.data(), ElemType::Int32, count);
+			do_not_optimize(xs[0]);
+		}
+	});
+	print_rate("generic_increment_n (int, batched)", (double) count * rounds,
+			batched, "elems");
+
+	std::vector<double> ds(count);
+	double batched_double = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			generic_increment_n(ds.data(), ElemType::Double, count);
+			do_not_optimize(ds[0]);
+		}
+	});
+	print_rate("generic_increment_n (double, batched)",
+			(double) count * rounds, batched_double, "elems");
+}
+
+void run_pointer_benchmarks(void) {
+	bench_generic_increment();
+}
@@ -2,5 +2,6 @@
 #define POINTER_TESTS_H_
 
 void run_pointer_tests(void);
+void run_pointer_benchmarks(void);
 
 #endif /* POINTER_TESTS_H_ */
@@ -0,0 +1,200 @@
+#ifndef POOL_ALLOC_H_
+#define POOL_ALLOC_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * Per thread pool of fixed size slots, carved from aligned slabs.
+ *
+ * Each thread allocates from its own pool, so allocation and freeing on the
+ * owning thread is just popping and pushing a list, without locks. A slot
+ * freed by another thread is pushed to the pool's remote list, which the
+ * owner takes over in one go when its own list runs out.
+ *
+ * Slabs are aligned to their size, so the pool a slot belongs to is found by
+ * rounding its address down to the slab header. When a thread exits its pool
+ * is kept, with the objects still in it, and adopted by the next new thread.
+ */
+template<size_t SlotSize>
+class SlabPool {
+	struct Slot {
+		Slot* next;
+	};
+
+	struct SlabHeader {
+		SlabPool* owner;
+		SlabHeader* next;
+	};
+
+	static_assert(SlotSize >= sizeof(Slot), "slot can not hold a link");
+	static_assert(SlotSize % alignof(Slot) == 0, "slot is misaligned");
+
+	Slot* free_list = nullptr;
+	std::atomic<Slot*> remote { nullptr };
+	SlabHeader* slabs = nullptr;
+	size_t slab_count = 0;
+
+	/**
+	 * Owns the pool of a thread and gives it up when the thread exits.
+	 */
+	struct ThreadPool {
+		SlabPool* pool;
+
+		ThreadPool() {
+			std::lock_guard<std::mutex> lock(orphans_mutex());
+			if (orphans().empty()) {
+				pool = new SlabPool;
+			} else {
+				pool = orphans().back();
+				orphans().pop_back();
+			}
+		}
+
+		~ThreadPool() {
+			std::lock_guard<std::mutex> lock(orphans_mutex());
+			orphans().push_back(pool);
+		}
+	};
+
+	static std::mutex& orphans_mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	// Never destroyed, since threads may still exit during static destruction
+	static std::vector<SlabPool*>& orphans() {
+		static std::vector<SlabPool*>* pools = new std::vector<SlabPool*>;
+		return *pools;
+	}
+
+	static SlabHeader* header_of(void* p) {
+		return (SlabHeader*) ((uintptr_t) p & ~(uintptr_t) (slab_bytes - 1));
+	}
+
+	/**
+	 * Adds a new slab and puts all of its slots in the free list.
+	 */
+	void grow() {
+		void* memory = aligned_alloc(slab_bytes, slab_bytes);
+		if (!memory) {
+			throw std::bad_alloc();
+		}
+		SlabHeader* slab = (SlabHeader*) memory;
+		slab->owner = this;
+		slab->next = slabs;
+		slabs = slab;
+		slab_count++;
+
+		char* first = (char*) memory + first_slot;
+		char* end = (char*) memory + slab_bytes;
+		for (char* p = end - SlotSize; p >= first; p -= SlotSize) {
+			Slot* slot = (Slot*) p;
+			slot->next = free_list;
+			free_list = slot;
+		}
+	}
+public:
+	static constexpr size_t slab_bytes = 64 << 10;
+
+	// The header takes the first slot, or as many as it needs
+	static constexpr size_t first_slot = (sizeof(SlabHeader) + SlotSize - 1)
+			/ SlotSize * SlotSize;
+
+	/**
+	 * Returns the pool of the calling thread.
+	 */
+	static SlabPool& local() {
+		static thread_local ThreadPool thread_pool;
+		return *thread_pool.pool;
+	}
+
+	void* allocate() {
+		if (!free_list) {
+			free_list = remote.exchange(nullptr, std::memory_order_acquire);
+			if (!free_list) {
+				grow();
+			}
+		}
+		Slot* slot = free_list;
+		free_list = slot->next;
+		return slot;
+	}
+
+	/**
+	 * Returns a slot to the pool it was allocated from, which may belong to
+	 * another thread.
+	 */
+	static void deallocate(void* p) {
+		SlabPool* owner = header_of(p)->owner;
+		Slot* slot = (Slot*) p;
+		if (owner == &local()) {
+			slot->next = owner->free_list;
+			owner->free_list = slot;
+			return;
+		}
+		slot->next = owner->remote.load(std::memory_order_relaxed);
+		while (!owner->remote.compare_exchange_weak(slot->next, slot,
+				std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
+
+	/**
+	 * Returns the bytes taken by the slabs of this pool.
+	 */
+	size_t reserved_bytes() const {
+		return slab_count * slab_bytes;
+	}
+};
+
+/**
+ * Returns the size of the pool slots of objects of type T, rounded up so
+ * that every slot is suitably aligned.
+ */
+template<class T>
+constexpr size_t pool_slot_size() {
+	size_t align = alignof(std::max_align_t);
+	return (sizeof(T) + align - 1) / align * align;
+}
+
+/**
+ * The pool objects of type T are allocated from.
+ */
+template<class T>
+using PoolOf = SlabPool<pool_slot_size<T>()>;
+
+/**
+ * Base of classes whose objects are allocated from a per thread slab pool
+ * instead of the general purpose allocator.
+ *
+ * The class T derives from PoolAllocated<T>, and 'new T' and 'delete p' use
+ * the pool. Objects of a derived class of a different size still use the
+ * global allocator.
+ */
+template<class T>
+struct PoolAllocated {
+	static void* operator new(size_t size) {
+		if (size != sizeof(T)) {
+			return ::operator new(size);
+		}
+		return PoolOf<T>::local().allocate();
+	}
+
+	static void operator delete(void* p, size_t size) {
+		if (!p) {
+			return;
+		}
+		if (size != sizeof(T)) {
+			::operator delete(p);
+			return;
+		}
+		PoolOf<T>::deallocate(p);
+	}
+};
+
+#endif /* POOL_ALLOC_H_ */
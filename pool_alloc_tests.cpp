@@ -0,0 +1,173 @@
+#include <cassert>
+#include <malloc.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "data_structures.h"
+#include "pool_alloc.h"
+#include "pool_alloc_tests.h"
+
+using namespace std;
+
+/**
+ * Same as a Person, but allocated by the general purpose allocator.
+ */
+struct PlainPerson {
+	int age;
+	double height;
+};
+
+/**
+ * A class derived from a pooled class that does not fit in its slots.
+ */
+struct Student: Person {
+	long grades[8];
+};
+
+/**
+ * Tests that the slots of a pool are distinct and properly aligned.
+ */
+void test_pool_slots(void) {
+	vector<Person*> persons;
+	for (int i = 0; i < 10000; i++) {
+		Person* p = new Person;
+		p->age = i;
+		assert((uintptr_t) p % alignof(Person) == 0);
+		persons.push_back(p);
+	}
+	for (int i = 0; i < 10000; i++) {
+		assert(persons[i]->age == i);
+		delete persons[i];
+	}
+
+	// Larger derived objects fall back to the global allocator
+	Person* s = new Student;
+	delete (Student*) s;
+}
+
+/**
+ * Tests allocating on some threads and freeing on others.
+ */
+void test_pool_threads(void) {
+	const int count = 20000;
+	vector<Person*> persons(count);
+	thread producer([&] {
+		for (int i = 0; i < count; i++) {
+			persons[i] = new Person;
+			persons[i]->age = i;
+		}
+	});
+	producer.join();
+
+	// The producer has exited, so its pool is adopted by the consumer
+	thread consumer([&] {
+		for (int i = 0; i < count; i++) {
+			assert(persons[i]->age == i);
+			delete persons[i];
+		}
+		Person* p = new Person;
+		delete p;
+	});
+	consumer.join();
+}
+
+void run_pool_alloc_tests(void) {
+	test_pool_slots();
+	test_pool_threads();
+}
+
+/**
+ * Measures allocating and freeing millions of short lived objects, a batch
+ * at a time.
+ */
+template<class T>
+void bench_churn(const char* name) {
+	const int batch = 1000;
+	const int rounds = 5000;
+	vector<T*> objects(batch);
+
+	double seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			for (int i = 0; i < batch; i++) {
+				objects[i] = new T;
+			}
+			do_not_optimize(objects[0]);
+			for (int i = 0; i < batch; i++) {
+				delete objects[i];
+			}
+		}
+	});
+	print_rate(name, (double) batch * rounds, seconds, "allocs+frees");
+}
+
+/**
+ * Returns the bytes the general purpose allocator took from the system.
+ */
+static size_t malloc_reserved_bytes(void) {
+	struct mallinfo2 info = mallinfo2();
+	return info.arena + info.hblkhd;
+}
+
+/**
+ * Allocates a million objects, then for a few rounds frees a random three
+ * quarters of them and allocates as many again. While the new objects are
+ * allocated, buffers of random sizes are allocated between them, as other
+ * work would, and freed at the end of the round, so the freed space is
+ * scattered and shared when it is reused. Prints the bytes reserved per
+ * byte actually in use at the end.
+ */
+template<class T>
+void bench_fragmentation(const char* name, size_t (*reserved)(void)) {
+	const int count = 1000000;
+	// The bookkeeping is allocated first, so it is not counted
+	vector<T*> objects(count);
+	vector<int> freed;
+	freed.reserve(count);
+	vector<char*> buffers;
+	buffers.reserve(count);
+	size_t before = reserved();
+
+	for (int i = 0; i < count; i++) {
+		objects[i] = new T;
+	}
+	mt19937 random(7);
+	for (int round = 0; round < 4; round++) {
+		freed.clear();
+		for (int i = 0; i < count; i++) {
+			if (random() % 4 != 0) {
+				delete objects[i];
+				freed.push_back(i);
+			}
+		}
+		for (int i : freed) {
+			objects[i] = new T;
+			if (random() % 2 == 0) {
+				buffers.push_back(new char[16 + random() % 240]);
+			}
+		}
+		for (char* buffer : buffers) {
+			delete[] buffer;
+		}
+		buffers.clear();
+	}
+
+	size_t used = count * sizeof(T);
+	printf("%-40s %12.3f reserved/used\n", name,
+			(double) (reserved() - before) / used);
+	for (T* p : objects) {
+		delete p;
+	}
+}
+
+static size_t pool_reserved_bytes(void) {
+	return PoolOf<Person>::local().reserved_bytes();
+}
+
+void run_pool_alloc_benchmarks(void) {
+	bench_churn<PlainPerson>("new Person (global allocator)");
+	bench_churn<Person>("new Person (pool)");
+	bench_fragmentation<PlainPerson>("Person (global allocator)",
+			malloc_reserved_bytes);
+	bench_fragmentation<Person>("Person (pool)", pool_reserved_bytes);
+}
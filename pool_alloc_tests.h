@@ -0,0 +1,7 @@
+#ifndef POOL_ALLOC_TESTS_H_
+#define POOL_ALLOC_TESTS_H_
+
+void run_pool_alloc_tests(void);
+void run_pool_alloc_benchmarks(void);
+
+#endif /* POOL_ALLOC_TESTS_H_ */
@@ -0,0 +1,438 @@
+#ifndef REF_PTR_H_
+#define REF_PTR_H_
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+template<class T> class IntrusivePtr;
+template<class T> class IntrusiveWeak;
+
+/**
+ * State shared between a reference counted object and its weak references.
+ *
+ * It outlives the object for as long as weak references exist, so they can
+ * tell whether the object is still alive. The lock makes sure the object is
+ * not destroyed while a weak reference is taking a new strong reference.
+ */
+struct WeakBlock {
+	// One reference is held by the object itself
+	std::atomic<long> refs { 1 };
+	std::atomic_flag locked = ATOMIC_FLAG_INIT;
+	// Null once the object has been destroyed
+	void* object = nullptr;
+
+	void lock() {
+		while (locked.test_and_set(std::memory_order_acquire)) {
+		}
+	}
+
+	void unlock() {
+		locked.clear(std::memory_order_release);
+	}
+
+	void add_ref() {
+		refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void drop_ref() {
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete this;
+		}
+	}
+};
+
+/**
+ * Base of classes whose objects hold their own reference count.
+ *
+ * The class T derives from RefCounted<T> and its objects are then owned by
+ * 'IntrusivePtr<T>'. Since the count is inside the object, a raw pointer to
+ * the object can always be turned back into an owning pointer and no
+ * separate control block is ever allocated, except for a small block the
+ * first time a weak reference is taken.
+ */
+template<class T>
+class RefCounted {
+	std::atomic<long> refs { 0 };
+	std::atomic<WeakBlock*> weak { nullptr };
+
+	friend class IntrusivePtr<T>;
+	friend class IntrusiveWeak<T>;
+
+	void add_ref() {
+		refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release() {
+		if (refs.fetch_sub(1, std::memory_order_release) != 1) {
+			return;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		WeakBlock* block = weak.load(std::memory_order_acquire);
+		if (block) {
+			block->lock();
+			block->object = nullptr;
+			block->unlock();
+			block->drop_ref();
+		}
+		delete static_cast<T*>(this);
+	}
+
+	/**
+	 * Returns the weak block, creating it if this is the first weak
+	 * reference.
+	 */
+	WeakBlock* weak_block() {
+		WeakBlock* block = weak.load(std::memory_order_acquire);
+		if (block) {
+			return block;
+		}
+		WeakBlock* created = new WeakBlock;
+		created->object = static_cast<T*>(this);
+		if (weak.compare_exchange_strong(block, created,
+				std::memory_order_acq_rel)) {
+			return created;
+		}
+		delete created;
+		return block;
+	}
+protected:
+	RefCounted() = default;
+
+	// A copy is a new object, so it starts without references
+	RefCounted(const RefCounted&) {
+	}
+
+	RefCounted& operator=(const RefCounted&) {
+		return *this;
+	}
+
+	~RefCounted() = default;
+public:
+	long use_count() const {
+		return refs.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * Owning pointer to an object that holds its own reference count.
+ *
+ * The count is atomic, so pointers to the same object may be copied and
+ * destroyed from different threads.
+ */
+template<class T>
+class IntrusivePtr {
+	T* p;
+
+	friend class IntrusiveWeak<T>;
+
+	struct Adopt {
+	};
+
+	// Takes over a reference that has already been counted
+	IntrusivePtr(T* p, Adopt) :
+			p(p) {
+	}
+public:
+	IntrusivePtr() :
+			p(nullptr) {
+	}
+
+	explicit IntrusivePtr(T* p) :
+			p(p) {
+		if (p) {
+			p->add_ref();
+		}
+	}
+
+	IntrusivePtr(const IntrusivePtr& other) :
+			IntrusivePtr(other.p) {
+	}
+
+	IntrusivePtr(IntrusivePtr&& other) :
+			p(other.p) {
+		other.p = nullptr;
+	}
+
+	~IntrusivePtr() {
+		if (p) {
+			p->release();
+		}
+	}
+
+	IntrusivePtr& operator=(IntrusivePtr other) {
+		std::swap(p, other.p);
+		return *this;
+	}
+
+	T* get() const {
+		return p;
+	}
+
+	T& operator*() const {
+		return *p;
+	}
+
+	T* operator->() const {
+		return p;
+	}
+
+	explicit operator bool() const {
+		return p != nullptr;
+	}
+
+	void reset() {
+		IntrusivePtr().swap(*this);
+	}
+
+	void swap(IntrusivePtr& other) {
+		std::swap(p, other.p);
+	}
+};
+
+/**
+ * Creates a new reference counted object owned by an 'IntrusivePtr'.
+ */
+template<class T, class ... Args>
+IntrusivePtr<T> make_intrusive(Args&&... args) {
+	return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+/**
+ * Non owning reference to an object that holds its own reference count.
+ *
+ * It does not keep the object alive, but can tell whether it still is and
+ * take a new owning pointer to it if so.
+ */
+template<class T>
+class IntrusiveWeak {
+	WeakBlock* block;
+public:
+	IntrusiveWeak() :
+			block(nullptr) {
+	}
+
+	IntrusiveWeak(const IntrusivePtr<T>& ptr) :
+			block(nullptr) {
+		if (ptr) {
+			block = ptr->weak_block();
+			block->add_ref();
+		}
+	}
+
+	IntrusiveWeak(const IntrusiveWeak& other) :
+			block(other.block) {
+		if (block) {
+			block->add_ref();
+		}
+	}
+
+	~IntrusiveWeak() {
+		if (block) {
+			block->drop_ref();
+		}
+	}
+
+	IntrusiveWeak& operator=(IntrusiveWeak other) {
+		std::swap(block, other.block);
+		return *this;
+	}
+
+	/**
+	 * Returns an owning pointer to the object, or null if it was destroyed.
+	 */
+	IntrusivePtr<T> lock() const {
+		if (!block) {
+			return IntrusivePtr<T>();
+		}
+		block->lock();
+		T* object = static_cast<T*>(block->object);
+		long n = 0;
+		if (object) {
+			// The last owner may have just dropped its reference, in which
+			// case the object is about to be destroyed and must not be revived
+			n = object->refs.load(std::memory_order_relaxed);
+			while (n > 0 && !object->refs.compare_exchange_weak(n, n + 1,
+					std::memory_order_relaxed)) {
+			}
+		}
+		block->unlock();
+		if (n == 0) {
+			return IntrusivePtr<T>();
+		}
+		return IntrusivePtr<T>(object, typename IntrusivePtr<T>::Adopt());
+	}
+
+	bool expired() const {
+		return !lock();
+	}
+};
+
+template<class T> class LocalWeak;
+
+/**
+ * Control block and object of a 'LocalShared', in a single allocation.
+ */
+template<class T>
+struct LocalBlock {
+	long strong;
+	// Weak references, plus one for as long as there are strong references
+	long weak;
+	alignas(T) unsigned char storage[sizeof(T)];
+
+	T* object() {
+		return std::launder(reinterpret_cast<T*>(storage));
+	}
+};
+
+/**
+ * Shared owning pointer whose reference counts are not atomic.
+ *
+ * It is like a 'std::shared_ptr' created with 'std::make_shared', but since
+ * the counts are plain integers, copies are much cheaper. The price is that
+ * all copies of a pointer, strong or weak, must be used by a single thread.
+ */
+template<class T>
+class LocalShared {
+	LocalBlock<T>* b;
+
+	friend class LocalWeak<T>;
+
+	template<class U, class ... Args>
+	friend LocalShared<U> make_local_shared(Args&&...);
+
+	explicit LocalShared(LocalBlock<T>* b) :
+			b(b) {
+	}
+public:
+	LocalShared() :
+			b(nullptr) {
+	}
+
+	LocalShared(const LocalShared& other) :
+			b(other.b) {
+		if (b) {
+			b->strong++;
+		}
+	}
+
+	LocalShared(LocalShared&& other) :
+			b(other.b) {
+		other.b = nullptr;
+	}
+
+	~LocalShared() {
+		if (b && --b->strong == 0) {
+			b->object()->~T();
+			if (--b->weak == 0) {
+				delete b;
+			}
+		}
+	}
+
+	LocalShared& operator=(LocalShared other) {
+		std::swap(b, other.b);
+		return *this;
+	}
+
+	T* get() const {
+		return b ? b->object() : nullptr;
+	}
+
+	T& operator*() const {
+		return *b->object();
+	}
+
+	T* operator->() const {
+		return b->object();
+	}
+
+	explicit operator bool() const {
+		return b != nullptr;
+	}
+
+	long use_count() const {
+		return b ? b->strong : 0;
+	}
+
+	void reset() {
+		LocalShared().swap(*this);
+	}
+
+	void swap(LocalShared& other) {
+		std::swap(b, other.b);
+	}
+};
+
+/**
+ * Creates a new object owned by a 'LocalShared', allocated together with
+ * its reference counts.
+ */
+template<class T, class ... Args>
+LocalShared<T> make_local_shared(Args&&... args) {
+	LocalBlock<T>* b = new LocalBlock<T>;
+	try {
+		new (b->storage) T(std::forward<Args>(args)...);
+	} catch (...) {
+		delete b;
+		throw;
+	}
+	b->strong = 1;
+	b->weak = 1;
+	return LocalShared<T>(b);
+}
+
+/**
+ * Non owning reference to an object owned by a 'LocalShared'.
+ */
+template<class T>
+class LocalWeak {
+	LocalBlock<T>* b;
+public:
+	LocalWeak() :
+			b(nullptr) {
+	}
+
+	LocalWeak(const LocalShared<T>& ptr) :
+			b(ptr.b) {
+		if (b) {
+			b->weak++;
+		}
+	}
+
+	LocalWeak(const LocalWeak& other) :
+			b(other.b) {
+		if (b) {
+			b->weak++;
+		}
+	}
+
+	~LocalWeak() {
+		if (b && --b->weak == 0) {
+			delete b;
+		}
+	}
+
+	LocalWeak& operator=(LocalWeak other) {
+		std::swap(b, other.b);
+		return *this;
+	}
+
+	/**
+	 * Returns an owning pointer to the object, or null if it was destroyed.
+	 */
+	LocalShared<T> lock() const {
+		if (!b || b->strong == 0) {
+			return LocalShared<T>();
+		}
+		b->strong++;
+		return LocalShared<T>(b);
+	}
+
+	bool expired() const {
+		return !b || b->strong == 0;
+	}
+};
+
+#endif /* REF_PTR_H_ */
@@ -0,0 +1,236 @@
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "ref_ptr.h"
+#include "ref_ptr_tests.h"
+
+using namespace std;
+
+/**
+ * Number of 'Counted' objects alive.
+ */
+static int alive = 0;
+
+/**
+ * An object that holds its own reference count and tracks how many of its
+ * kind are alive.
+ */
+struct Counted: RefCounted<Counted> {
+	int value;
+
+	Counted(int value) :
+			value(value) {
+		alive++;
+	}
+
+	~Counted() {
+		alive--;
+	}
+};
+
+/**
+ * Like 'Counted', but without a reference count of its own.
+ */
+struct Plain {
+	int value;
+
+	Plain(int value) :
+			value(value) {
+		alive++;
+	}
+
+	~Plain() {
+		alive--;
+	}
+};
+
+/**
+ * Tests an intrusive pointer.
+ *
+ * The object is destroyed when the last pointer that owns it is destroyed.
+ */
+void test_intrusive_ptr(void) {
+	{
+		IntrusivePtr<Counted> p = make_intrusive<Counted>(1);
+		assert(alive == 1);
+		assert(p->use_count() == 1);
+
+		IntrusivePtr<Counted> q = p;
+		assert(p->use_count() == 2);
+		assert(q->value == 1);
+
+		// Moving transfers the reference instead of adding one
+		IntrusivePtr<Counted> r = std::move(q);
+		assert(!q);
+		assert(p->use_count() == 2);
+
+		// Since the count is in the object, a raw pointer can be owned again
+		IntrusivePtr<Counted> s(p.get());
+		assert(p->use_count() == 3);
+
+		r.reset();
+		s.reset();
+		assert(p->use_count() == 1);
+		assert(alive == 1);
+	}
+	assert(alive == 0);
+}
+
+/**
+ * Tests a weak reference to an intrusive pointer.
+ */
+void test_intrusive_weak(void) {
+	IntrusiveWeak<Counted> w;
+	assert(w.expired());
+	{
+		IntrusivePtr<Counted> p = make_intrusive<Counted>(2);
+		w = p;
+		IntrusiveWeak<Counted> v = w;
+		assert(!v.expired());
+
+		// A weak reference does not keep the object alive
+		assert(p->use_count() == 1);
+
+		IntrusivePtr<Counted> q = w.lock();
+		assert(q.get() == p.get());
+		assert(p->use_count() == 2);
+	}
+	assert(alive == 0);
+	assert(w.expired());
+	assert(!w.lock());
+}
+
+/**
+ * Tests copying and destroying intrusive pointers from many threads.
+ */
+void test_intrusive_threads(void) {
+	IntrusivePtr<Counted> p = make_intrusive<Counted>(3);
+	IntrusiveWeak<Counted> w = p;
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&] {
+			for (int i = 0; i < 10000; i++) {
+				IntrusivePtr<Counted> q = p;
+				IntrusivePtr<Counted> r = w.lock();
+				assert(q.get() == r.get());
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+	assert(p->use_count() == 1);
+	p.reset();
+	assert(alive == 0);
+}
+
+/**
+ * Tests a shared pointer with non atomic counts.
+ */
+void test_local_shared(void) {
+	LocalWeak<Plain> w;
+	{
+		LocalShared<Plain> p = make_local_shared<Plain>(4);
+		assert(alive == 1);
+		assert(p.use_count() == 1);
+		assert(p->value == 4);
+
+		LocalShared<Plain> q = p;
+		assert(p.use_count() == 2);
+
+		w = q;
+		assert(p.use_count() == 2);
+		assert(w.lock().get() == p.get());
+
+		LocalShared<Plain> r = std::move(q);
+		assert(!q);
+		assert(p.use_count() == 2);
+	}
+	// The object is destroyed, but the weak reference still holds the block
+	assert(alive == 0);
+	assert(w.expired());
+	assert(!w.lock());
+}
+
+void run_ref_ptr_tests(void) {
+	test_intrusive_ptr();
+	test_intrusive_weak();
+	test_intrusive_threads();
+	test_local_shared();
+}
+
+/**
+ * Measures copying then destroying a pointer, and dereferencing it.
+ */
+template<class Ptr>
+void bench_single_thread(const char* name, const Ptr& p) {
+	const long count = 20000000;
+	char label[64];
+
+	double copy = time_seconds([&] {
+		for (long i = 0; i < count; i++) {
+			Ptr q = p;
+			do_not_optimize(q);
+		}
+	});
+	snprintf(label, sizeof(label), "%s copy+destroy", name);
+	print_rate(label, count, copy, "ops");
+
+	// Keeps the pointers in memory, so each dereference is a real load
+	vector<Ptr> ptrs(1024, p);
+	double deref = time_seconds([&] {
+		for (long i = 0; i < count; i += ptrs.size()) {
+			long sum = 0;
+			for (const Ptr& q : ptrs) {
+				sum += q->value;
+			}
+			do_not_optimize(sum);
+		}
+	});
+	snprintf(label, sizeof(label), "%s dereference", name);
+	print_rate(label, count, deref, "ops");
+}
+
+/**
+ * Measures copying then destroying a pointer to the same object from many
+ * threads at once, which all fight over the cache line of the count.
+ */
+template<class Ptr>
+void bench_contended(const char* name, const Ptr& p) {
+	const long count = 2000000;
+	int n = max(thread::hardware_concurrency(), 2u);
+
+	double seconds = time_seconds([&] {
+		vector<thread> threads;
+		for (int t = 0; t < n; t++) {
+			threads.emplace_back([&] {
+				for (long i = 0; i < count; i++) {
+					Ptr q = p;
+					do_not_optimize(q);
+				}
+			});
+		}
+		for (thread& t : threads) {
+			t.join();
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s copy+destroy, %d threads", name, n);
+	print_rate(label, (double) count * n, seconds, "ops");
+}
+
+void run_ref_ptr_benchmarks(void) {
+	shared_ptr<Plain> shared = make_shared<Plain>(1);
+	IntrusivePtr<Counted> intrusive = make_intrusive<Counted>(1);
+	LocalShared<Plain> local = make_local_shared<Plain>(1);
+
+	bench_single_thread("shared_ptr", shared);
+	bench_single_thread("IntrusivePtr", intrusive);
+	bench_single_thread("LocalShared", local);
+
+	// A 'LocalShared' can not be shared by threads
+	bench_contended("shared_ptr", shared);
+	bench_contended("IntrusivePtr", intrusive);
+}
@@ -0,0 +1,7 @@
+#ifndef REF_PTR_TESTS_H_
+#define REF_PTR_TESTS_H_
+
+void run_ref_ptr_tests(void);
+void run_ref_ptr_benchmarks(void);
+
+#endif /* REF_PTR_TESTS_H_ */
@@ -0,0 +1,208 @@
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Size of a cache line. Indices written by different threads are kept this
+ * far apart, so that writing one does not invalidate the cache line of the
+ * other (false sharing).
+ */
+constexpr size_t cache_line_size = 64;
+
+/**
+ * Bounded queue for exactly one producer thread and one consumer thread.
+ *
+ * Pushing and popping never wait for the other thread. Each side keeps a
+ * copy of the other side's index and only reads the shared one when the
+ * copy says the queue is full (or empty), so most operations touch no cache
+ * line written by the other thread.
+ *
+ * The capacity N must be a power of two, so that an index wraps around the
+ * array with a mask instead of a division.
+ */
+template<class T, size_t N>
+class SpscRing {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of 2");
+
+	// Written by the consumer
+	alignas(cache_line_size) std::atomic<size_t> head { 0 };
+	size_t cached_tail = 0;
+
+	// Written by the producer
+	alignas(cache_line_size) std::atomic<size_t> tail { 0 };
+	size_t cached_head = 0;
+
+	alignas(cache_line_size) std::array<T, N> slots;
+public:
+	/**
+	 * Pushes an item, returning false if the queue is full.
+	 */
+	bool push(const T& item) {
+		return push_batch(&item, 1) == 1;
+	}
+
+	/**
+	 * Pops an item, returning false if the queue is empty.
+	 */
+	bool pop(T& item) {
+		return pop_batch(&item, 1) == 1;
+	}
+
+	/**
+	 * Pushes as many of count items as fit, returning how many were pushed.
+	 *
+	 * The whole batch is published with a single store.
+	 */
+	size_t push_batch(const T* items, size_t count) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (N - (t - cached_head) < count) {
+			cached_head = head.load(std::memory_order_acquire);
+		}
+		size_t free = N - (t - cached_head);
+		size_t n = count < free ? count : free;
+		for (size_t i = 0; i < n; i++) {
+			slots[(t + i) & (N - 1)] = items[i];
+		}
+		tail.store(t + n, std::memory_order_release);
+		return n;
+	}
+
+	/**
+	 * Pops up to count items, returning how many were popped.
+	 */
+	size_t pop_batch(T* items, size_t count) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (cached_tail - h < count) {
+			cached_tail = tail.load(std::memory_order_acquire);
+		}
+		size_t used = cached_tail - h;
+		size_t n = count < used ? count : used;
+		for (size_t i = 0; i < n; i++) {
+			items[i] = slots[(h + i) & (N - 1)];
+		}
+		head.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	static constexpr size_t capacity() {
+		return N;
+	}
+};
+
+/**
+ * Bounded queue for any number of producer and consumer threads.
+ *
+ * Every slot has a sequence number telling whether it is ready to be
+ * written or read for the current lap around the array. A thread claims a
+ * slot by advancing the shared index with a compare and swap, and then
+ * publishes it by advancing the slot's sequence number, so threads never
+ * hold a lock.
+ *
+ * The capacity N must be a power of two, and at least two, since with a
+ * single slot a full slot and an empty one of the next lap look the same.
+ */
+template<class T, size_t N>
+class MpmcRing {
+	static_assert(N > 1 && (N & (N - 1)) == 0, "capacity must be a power of 2");
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	alignas(cache_line_size) std::atomic<size_t> tail { 0 };
+	alignas(cache_line_size) std::atomic<size_t> head { 0 };
+	alignas(cache_line_size) std::array<Slot, N> slots;
+public:
+	MpmcRing() {
+		for (size_t i = 0; i < N; i++) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Pushes an item, returning false if the queue is full.
+	 */
+	bool push(const T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[t & (N - 1)];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			long diff = (long) sequence - (long) t;
+			if (diff == 0) {
+				if (tail.compare_exchange_weak(t, t + 1,
+						std::memory_order_relaxed)) {
+					slot.item = item;
+					slot.sequence.store(t + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// The slot has not been read since the last lap
+				return false;
+			} else {
+				t = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Pops an item, returning false if the queue is empty.
+	 */
+	bool pop(T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[h & (N - 1)];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			long diff = (long) sequence - (long) (h + 1);
+			if (diff == 0) {
+				if (head.compare_exchange_weak(h, h + 1,
+						std::memory_order_relaxed)) {
+					item = slot.item;
+					slot.sequence.store(h + N, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				// The slot has not been written in this lap yet
+				return false;
+			} else {
+				h = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Pushes items until count were pushed or the queue is full, returning
+	 * how many were pushed.
+	 *
+	 * Claiming several slots at once would have to wait for slots that are
+	 * still being read by slower consumers, so each item is claimed on its
+	 * own and the batch stays lock-free.
+	 */
+	size_t push_batch(const T* items, size_t count) {
+		size_t n = 0;
+		while (n < count && push(items[n])) {
+			n++;
+		}
+		return n;
+	}
+
+	/**
+	 * Pops up to count items, returning how many were popped.
+	 */
+	size_t pop_batch(T* items, size_t count) {
+		size_t n = 0;
+		while (n < count && pop(items[n])) {
+			n++;
+		}
+		return n;
+	}
+
+	static constexpr size_t capacity() {
+		return N;
+	}
+};
+
+#endif /* RING_BUFFER_H_ */
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "ring_buffer.h"
+#include "ring_buffer_tests.h"
+
+using namespace std;
+
+/**
+ * Tests a ring from a single thread, until it wraps around several times.
+ */
+template<class Ring>
+void test_ring_basics(void) {
+	unique_ptr<Ring> ring(new Ring);
+	const long n = Ring::capacity();
+	long x;
+	assert(!ring->pop(x));
+
+	for (long lap = 0; lap < 3; lap++) {
+		for (long i = 0; i < n; i++) {
+			assert(ring->push(lap * n + i));
+		}
+		assert(!ring->push(-1));
+		for (long i = 0; i < n; i++) {
+			assert(ring->pop(x));
+			assert(x == lap * n + i);
+		}
+		assert(!ring->pop(x));
+	}
+
+	// A batch only goes in as far as there is room
+	long in[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	long out[10];
+	assert(ring->push_batch(in, 10) == (size_t) min(n, 10L));
+	assert(ring->pop_batch(out, 10) == (size_t) min(n, 10L));
+	assert(out[0] == 1);
+	assert(ring->pop_batch(out, 10) == 0);
+}
+
+/**
+ * Tests one producer and one consumer, which must see every item in order.
+ */
+void test_spsc_stress(void) {
+	const long count = 1000000;
+	unique_ptr<SpscRing<long, 1024>> ring(new SpscRing<long, 1024>);
+
+	thread producer([&] {
+		long batch[16];
+		long next = 0;
+		while (next < count) {
+			long n = min(16L, count - next);
+			for (long i = 0; i < n; i++) {
+				batch[i] = next + i;
+			}
+			long pushed = ring->push_batch(batch, n);
+			next += pushed;
+			if (pushed == 0) {
+				this_thread::yield();
+			}
+		}
+	});
+
+	long expected = 0;
+	long batch[16];
+	while (expected < count) {
+		size_t n = ring->pop_batch(batch, 16);
+		for (size_t i = 0; i < n; i++) {
+			assert(batch[i] == expected++);
+		}
+		if (n == 0) {
+			this_thread::yield();
+		}
+	}
+	producer.join();
+}
+
+/**
+ * Tests several producers and consumers under contention.
+ *
+ * Every item must be popped exactly once, and a consumer must see the items
+ * of each producer in the order they were pushed.
+ */
+void test_mpmc_stress(void) {
+	const int producers = 4;
+	const int consumers = 4;
+	const long count = 200000;
+	unique_ptr<MpmcRing<long, 256>> ring(new MpmcRing<long, 256>);
+	vector<vector<long>> popped(consumers);
+	atomic<long> remaining(producers * count);
+
+	vector<thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p] {
+			for (long i = 0; i < count; i++) {
+				while (!ring->push(p * count + i)) {
+					this_thread::yield();
+				}
+			}
+		});
+	}
+	for (int c = 0; c < consumers; c++) {
+		threads.emplace_back([&, c] {
+			vector<long> last(producers, -1);
+			long x;
+			while (remaining.load() > 0) {
+				if (!ring->pop(x)) {
+					this_thread::yield();
+					continue;
+				}
+				remaining--;
+				long p = x / count;
+				assert(x % count > last[p]);
+				last[p] = x % count;
+				popped[c].push_back(x);
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+
+	vector<long> all;
+	for (vector<long>& items : popped) {
+		all.insert(all.end(), items.begin(), items.end());
+	}
+	sort(all.begin(), all.end());
+	assert((long) all.size() == producers * count);
+	for (long i = 0; i < producers * count; i++) {
+		assert(all[i] == i);
+	}
+}
+
+void run_ring_buffer_tests(void) {
+	test_ring_basics<SpscRing<long, 8>>();
+	test_ring_basics<MpmcRing<long, 8>>();
+	test_ring_basics<SpscRing<long, 1>>();
+	test_ring_basics<MpmcRing<long, 2>>();
+	test_spsc_stress();
+	test_mpmc_stress();
+}
+
+/**
+ * Returns a steady clock timestamp in nanoseconds.
+ */
+static long now_ns(void) {
+	return chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Sends timestamped messages from producers to consumers through a ring and
+ * prints the messages per second and percentiles of the time from push to
+ * pop of every 16th message.
+ */
+template<class Ring>
+void bench_ring(const char* name, int producers, int consumers) {
+	const long count = 1000000 / producers;
+	unique_ptr<Ring> ring(new Ring);
+	atomic<long> remaining((long) count * producers);
+	vector<vector<long>> latencies(consumers);
+
+	double seconds = time_seconds([&] {
+		vector<thread> threads;
+		for (int p = 0; p < producers; p++) {
+			threads.emplace_back([&] {
+				for (long i = 0; i < count; i++) {
+					while (!ring->push(now_ns())) {
+						this_thread::yield();
+					}
+				}
+			});
+		}
+		for (int c = 0; c < consumers; c++) {
+			threads.emplace_back([&, c] {
+				long sent;
+				long n = 0;
+				while (remaining.load(memory_order_relaxed) > 0) {
+					if (!ring->pop(sent)) {
+						this_thread::yield();
+						continue;
+					}
+					remaining.fetch_sub(1, memory_order_relaxed);
+					if (n++ % 16 == 0) {
+						latencies[c].push_back(now_ns() - sent);
+					}
+				}
+			});
+		}
+		for (thread& t : threads) {
+			t.join();
+		}
+	});
+
+	vector<long> all;
+	for (vector<long>& l : latencies) {
+		all.insert(all.end(), l.begin(), l.end());
+	}
+	sort(all.begin(), all.end());
+	char label[64];
+	snprintf(label, sizeof(label), "%s %dP/%dC", name, producers, consumers);
+	printf("%-40s %12.3f Mmsgs/s  p50 %ld ns  p99 %ld ns  p99.9 %ld ns\n",
+			label, (double) count * producers / seconds / 1e6,
+			all[all.size() / 2], all[all.size() * 99 / 100],
+			all[all.size() * 999 / 1000]);
+}
+
+void run_ring_buffer_benchmarks(void) {
+	bench_ring<SpscRing<long, 1024>>("SpscRing", 1, 1);
+	int n = max((int) thread::hardware_concurrency() / 2, 2);
+	for (int threads = 1; threads <= n; threads *= 2) {
+		bench_ring<MpmcRing<long, 1024>>("MpmcRing", threads, threads);
+	}
+}
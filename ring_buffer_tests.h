@@ -0,0 +1,7 @@
+#ifndef RING_BUFFER_TESTS_H_
+#define RING_BUFFER_TESTS_H_
+
+void run_ring_buffer_tests(void);
+void run_ring_buffer_benchmarks(void);
+
+#endif /* RING_BUFFER_TESTS_H_ */
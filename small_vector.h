@@ -0,0 +1,290 @@
+#ifndef SMALL_VECTOR_H_
+#define SMALL_VECTOR_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Whether objects of type T can be moved to another address by copying
+ * their bytes, leaving nothing to destroy at the old address.
+ */
+template<class T>
+constexpr bool is_trivially_relocatable = std::is_trivially_copyable<T>::value;
+
+/**
+ * Vector whose first elements may be stored inside another object, a
+ * 'SmallVector<T, N>' of any inline capacity N.
+ *
+ * Functions take a 'SmallVectorRef<T>&' to read and change a small vector
+ * without being templates on N. A reference can not be created or
+ * destroyed on its own, only through a 'SmallVector'.
+ */
+template<class T>
+class SmallVectorRef {
+	T* first;
+	size_t count;
+	size_t room;
+	// The inline storage of the 'SmallVector', which may be empty
+	T* inline_first;
+	size_t inline_room;
+
+	static void relocate(T* from, size_t n, T* to) {
+		if constexpr (is_trivially_relocatable<T>) {
+			if (n > 0) {
+				memcpy((void*) to, (const void*) from, n * sizeof(T));
+			}
+		} else {
+			for (size_t i = 0; i < n; i++) {
+				new (to + i) T(std::move(from[i]));
+				from[i].~T();
+			}
+		}
+	}
+
+	void free_heap() {
+		if (first != inline_first) {
+			std::allocator<T>().deallocate(first, room);
+		}
+	}
+
+	/**
+	 * Moves the elements to a heap buffer of at least the given capacity,
+	 * after constructing the element at index count from args, which may
+	 * refer to an element of the old buffer.
+	 */
+	template<class ... Args>
+	T& grow_and_emplace(size_t capacity, Args&&... args) {
+		if (capacity < room * 2) {
+			capacity = room * 2;
+		}
+		T* buffer = std::allocator<T>().allocate(capacity);
+		new (buffer + count) T(std::forward<Args>(args)...);
+		relocate(first, count, buffer);
+		free_heap();
+		first = buffer;
+		room = capacity;
+		return first[count++];
+	}
+protected:
+	SmallVectorRef(T* inline_first, size_t inline_capacity) :
+			first(inline_first), count(0), room(inline_capacity), inline_first(
+					inline_first), inline_room(inline_capacity) {
+	}
+
+	~SmallVectorRef() {
+		clear();
+		free_heap();
+	}
+
+	/**
+	 * Takes the elements of other, stealing its buffer if it is on the heap.
+	 */
+	void take(SmallVectorRef& other) {
+		if (other.first != other.inline_first) {
+			clear();
+			free_heap();
+			first = std::exchange(other.first, other.inline_first);
+			room = std::exchange(other.room, other.inline_room);
+			count = std::exchange(other.count, 0);
+			return;
+		}
+		clear();
+		reserve(other.count);
+		relocate(other.first, other.count, first);
+		count = std::exchange(other.count, 0);
+	}
+public:
+	SmallVectorRef(const SmallVectorRef&) = delete;
+
+	SmallVectorRef& operator=(const SmallVectorRef& other) {
+		if (this != &other) {
+			clear();
+			reserve(other.count);
+			std::uninitialized_copy(other.first, other.first + other.count,
+					first);
+			count = other.count;
+		}
+		return *this;
+	}
+
+	SmallVectorRef& operator=(SmallVectorRef&& other) {
+		if (this != &other) {
+			take(other);
+		}
+		return *this;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	size_t capacity() const {
+		return room;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	/**
+	 * Returns whether the elements are stored inline, without allocating.
+	 */
+	bool is_inline() const {
+		return first == inline_first;
+	}
+
+	T* data() {
+		return first;
+	}
+
+	const T* data() const {
+		return first;
+	}
+
+	T* begin() {
+		return first;
+	}
+
+	T* end() {
+		return first + count;
+	}
+
+	const T* begin() const {
+		return first;
+	}
+
+	const T* end() const {
+		return first + count;
+	}
+
+	T& operator[](size_t i) {
+		assert(i < count);
+		return first[i];
+	}
+
+	const T& operator[](size_t i) const {
+		assert(i < count);
+		return first[i];
+	}
+
+	T& back() {
+		assert(count > 0);
+		return first[count - 1];
+	}
+
+	template<class ... Args>
+	T& emplace_back(Args&&... args) {
+		if (count == room) {
+			return grow_and_emplace(count + 1, std::forward<Args>(args)...);
+		}
+		new (first + count) T(std::forward<Args>(args)...);
+		return first[count++];
+	}
+
+	void push_back(const T& x) {
+		emplace_back(x);
+	}
+
+	void push_back(T&& x) {
+		emplace_back(std::move(x));
+	}
+
+	void pop_back() {
+		assert(count > 0);
+		first[--count].~T();
+	}
+
+	void clear() {
+		std::destroy(first, first + count);
+		count = 0;
+	}
+
+	void reserve(size_t capacity) {
+		if (capacity <= room) {
+			return;
+		}
+		T* buffer = std::allocator<T>().allocate(capacity);
+		relocate(first, count, buffer);
+		free_heap();
+		first = buffer;
+		room = capacity;
+	}
+
+	/**
+	 * Makes the size n, removing elements from the end or adding value
+	 * initialized ones.
+	 */
+	void resize(size_t n) {
+		if (n < count) {
+			std::destroy(first + n, first + count);
+		} else {
+			reserve(n);
+			std::uninitialized_value_construct(first + count, first + n);
+		}
+		count = n;
+	}
+};
+
+/**
+ * Vector that stores up to N elements inside itself, and only allocates
+ * on the heap when it grows beyond N.
+ *
+ * Most collections that are nearly always small then never allocate. Types
+ * that can be relocated by copying their bytes are moved with 'memcpy'
+ * when the vector grows or moves.
+ */
+template<class T, size_t N>
+class SmallVector: public SmallVectorRef<T> {
+	// At least one element, since arrays can not be empty
+	alignas(T) unsigned char storage[(N > 0 ? N : 1) * sizeof(T)];
+public:
+	SmallVector() :
+			SmallVectorRef<T>((T*) storage, N) {
+	}
+
+	SmallVector(std::initializer_list<T> items) :
+			SmallVector() {
+		this->reserve(items.size());
+		for (const T& item : items) {
+			this->push_back(item);
+		}
+	}
+
+	SmallVector(const SmallVector& other) :
+			SmallVector() {
+		SmallVectorRef<T>::operator=(other);
+	}
+
+	SmallVector(const SmallVectorRef<T>& other) :
+			SmallVector() {
+		SmallVectorRef<T>::operator=(other);
+	}
+
+	SmallVector(SmallVector&& other) :
+			SmallVector() {
+		this->take(other);
+	}
+
+	SmallVector(SmallVectorRef<T>&& other) :
+			SmallVector() {
+		this->take(other);
+	}
+
+	SmallVector& operator=(const SmallVector& other) {
+		SmallVectorRef<T>::operator=(other);
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& other) {
+		SmallVectorRef<T>::operator=(std::move(other));
+		return *this;
+	}
+};
+
+#endif /* SMALL_VECTOR_H_ */
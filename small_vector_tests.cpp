@@ -0,0 +1,187 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "small_vector.h"
+#include "small_vector_tests.h"
+
+using namespace std;
+
+/**
+ * Counts its live objects, to check that every element is destroyed once.
+ */
+struct CountedElement {
+	static int live;
+	int value;
+
+	CountedElement(int value = 0) :
+			value(value) {
+		live++;
+	}
+
+	CountedElement(const CountedElement& other) :
+			value(other.value) {
+		live++;
+	}
+
+	CountedElement(CountedElement&& other) :
+			value(other.value) {
+		other.value = -1;
+		live++;
+	}
+
+	CountedElement& operator=(const CountedElement&) = default;
+
+	~CountedElement() {
+		live--;
+	}
+};
+
+int CountedElement::live = 0;
+
+/**
+ * Takes any small vector of ints, whatever its inline capacity.
+ */
+static int sum_and_append(SmallVectorRef<int>& xs, int x) {
+	int sum = 0;
+	for (int y : xs) {
+		sum += y;
+	}
+	xs.push_back(x);
+	return sum;
+}
+
+/**
+ * Tests that a small vector stays inline up to its inline capacity and then
+ * moves to the heap.
+ */
+void test_small_vector(void) {
+	SmallVector<int, 4> xs;
+	assert(xs.empty() && xs.capacity() == 4 && xs.is_inline());
+	for (int i = 0; i < 4; i++) {
+		xs.push_back(i);
+	}
+	assert(xs.is_inline());
+	xs.push_back(4);
+	assert(!xs.is_inline() && xs.size() == 5 && xs.capacity() >= 5);
+	for (int i = 0; i < 5; i++) {
+		assert(xs[i] == i);
+	}
+	xs.pop_back();
+	assert(xs.back() == 3);
+
+	// Pushing an element of the vector itself while it grows
+	SmallVector<int, 2> ys = { 7, 8 };
+	ys.push_back(ys[0]);
+	assert(ys.size() == 3 && ys[2] == 7);
+
+	ys.resize(5);
+	assert(ys[3] == 0 && ys[4] == 0);
+	ys.resize(1);
+	assert(ys.size() == 1 && ys[0] == 7);
+
+	// Functions need not know the inline capacity
+	SmallVector<int, 8> zs = { 1, 2 };
+	assert(sum_and_append(xs, 10) == 0 + 1 + 2 + 3);
+	assert(sum_and_append(zs, 10) == 3);
+	assert(zs.size() == 3 && zs.is_inline());
+
+	SmallVector<int, 0> none;
+	none.push_back(1);
+	assert(!none.is_inline() && none[0] == 1);
+}
+
+/**
+ * Tests copying and moving inline and heap vectors, with elements that must
+ * be moved and destroyed one by one.
+ */
+void test_small_vector_moves(void) {
+	{
+		SmallVector<CountedElement, 2> inline_items = { 1, 2 };
+		SmallVector<CountedElement, 2> heap_items = { 1, 2, 3, 4 };
+		assert(CountedElement::live == 6);
+
+		// An inline vector moves its elements
+		SmallVector<CountedElement, 2> a = std::move(inline_items);
+		assert(a.is_inline() && a.size() == 2 && a[1].value == 2);
+		assert(inline_items.empty());
+
+		// A heap vector hands over its buffer
+		const CountedElement* buffer = heap_items.data();
+		SmallVector<CountedElement, 2> b = std::move(heap_items);
+		assert(b.data() == buffer && b.size() == 4);
+		assert(heap_items.empty() && heap_items.is_inline());
+		assert(heap_items.capacity() == 2);
+		assert(CountedElement::live == 6);
+
+		SmallVector<CountedElement, 2> c = b;
+		assert(c.size() == 4 && c[3].value == 4 && CountedElement::live == 10);
+		c = a;
+		assert(c.size() == 2 && CountedElement::live == 8);
+		a = std::move(b);
+		assert(a.size() == 4 && b.empty() && CountedElement::live == 6);
+
+		// Through references, between different inline capacities, where the
+		// heap buffer is taken even though the elements would fit inline
+		SmallVector<CountedElement, 8> d;
+		SmallVectorRef<CountedElement>& ref = d;
+		ref = std::move(a);
+		assert(d.size() == 4 && !d.is_inline() && CountedElement::live == 6);
+		SmallVector<CountedElement, 1> f = { 5 };
+		SmallVector<CountedElement, 8> e = std::move(f);
+		assert(e.size() == 1 && e.is_inline() && CountedElement::live == 7);
+	}
+	assert(CountedElement::live == 0);
+
+	SmallVector<string, 1> words = { "short" };
+	words.push_back(string(100, 'x'));
+	words.emplace_back("third");
+	assert(words[0] == "short" && words[1].size() == 100
+			&& words[2] == "third");
+}
+
+void run_small_vector_tests(void) {
+	test_small_vector();
+	test_small_vector_moves();
+}
+
+/**
+ * Creates, fills, sums and destroys vectors of the given size many times,
+ * and counts the allocations they made by counting how often their buffer
+ * changed.
+ */
+template<class V>
+void bench_vector(const char* name, int size) {
+	const int rounds = 2000000 / (size + 4);
+	long allocations = 0;
+	double seconds = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			V v;
+			const int* buffer = v.data();
+			for (int i = 0; i < size; i++) {
+				v.push_back(i);
+				if (v.data() != buffer) {
+					buffer = v.data();
+					allocations++;
+				}
+			}
+			int sum = 0;
+			for (int x : v) {
+				sum += x;
+			}
+			do_not_optimize(sum);
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s, %d ints", name, size);
+	print_rate(label, rounds, seconds, "vectors");
+	printf("%-40s %12.3f allocs/vector\n", label, (double) allocations / rounds);
+}
+
+void run_small_vector_benchmarks(void) {
+	for (int size : { 0, 1, 4, 8, 16, 32, 64 }) {
+		bench_vector<vector<int>>("std::vector", size);
+		bench_vector<SmallVector<int, 16>>("SmallVector<int, 16>", size);
+	}
+}
@@ -0,0 +1,7 @@
+#ifndef SMALL_VECTOR_TESTS_H_
+#define SMALL_VECTOR_TESTS_H_
+
+void run_small_vector_tests(void);
+void run_small_vector_benchmarks(void);
+
+#endif /* SMALL_VECTOR_TESTS_H_ */
@@ -0,0 +1,189 @@
+#ifndef SPAN_H_
+#define SPAN_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Iterator over elements that are a fixed number of elements apart.
+ *
+ * The iterator keeps the index of its element rather than a pointer to it,
+ * since a pointer one stride past the last element can be past the end of
+ * the array, which is undefined. Iterators are equal if their indices are.
+ *
+ * If Prefetch is true, every step also asks the processor to start loading
+ * the element that is a given distance ahead, so that it is already in cache
+ * by the time it is reached. A prefetch is only a hint, so prefetching past
+ * the end of the data is harmless.
+ */
+template<class T, bool Prefetch = false>
+class StridedIterator {
+	T* base;
+	ptrdiff_t stride;
+	size_t index;
+	ptrdiff_t ahead;
+public:
+	StridedIterator(T* base, ptrdiff_t stride, size_t index, ptrdiff_t ahead =
+			0) :
+			base(base), stride(stride), index(index), ahead(
+					ahead * stride * sizeof(T)) {
+	}
+
+	T& operator*() const {
+		return base[(ptrdiff_t) index * stride];
+	}
+
+	T* operator->() const {
+		return &**this;
+	}
+
+	StridedIterator& operator++() {
+		index++;
+		if (Prefetch) {
+			// Computed as an integer, since pointing past the end is undefined
+			__builtin_prefetch((const void*) ((uintptr_t) base
+					+ (ptrdiff_t) index * stride * sizeof(T) + ahead));
+		}
+		return *this;
+	}
+
+	StridedIterator operator++(int) {
+		StridedIterator old = *this;
+		++*this;
+		return old;
+	}
+
+	bool operator==(const StridedIterator& other) const {
+		return index == other.index;
+	}
+
+	bool operator!=(const StridedIterator& other) const {
+		return index != other.index;
+	}
+};
+
+/**
+ * A pair of iterators, so that a range can be used in a range-based for.
+ */
+template<class It>
+struct Range {
+	It first;
+	It last;
+
+	It begin() const {
+		return first;
+	}
+
+	It end() const {
+		return last;
+	}
+};
+
+/**
+ * A view over a contiguous sequence of elements.
+ *
+ * Element access is bounds checked with 'assert', so the checks are only done
+ * in debug builds. With NDEBUG defined a span is just a pointer and a size.
+ */
+template<class T>
+class Span {
+	T* ptr;
+	size_t len;
+public:
+	Span(T* data, size_t size) :
+			ptr(data), len(size) {
+	}
+
+	template<size_t S>
+	Span(T (&array)[S]) :
+			ptr(array), len(S) {
+	}
+
+	T* data() const {
+		return ptr;
+	}
+
+	size_t size() const {
+		return len;
+	}
+
+	T& operator[](size_t i) const {
+		assert(i < len);
+		return ptr[i];
+	}
+
+	T* begin() const {
+		return ptr;
+	}
+
+	T* end() const {
+		return ptr + len;
+	}
+
+	/**
+	 * Returns the view of count elements starting at offset.
+	 */
+	Span subspan(size_t offset, size_t count) const {
+		assert(offset <= len && count <= len - offset);
+		return Span(ptr + offset, count);
+	}
+
+	/**
+	 * Returns a range that prefetches distance elements ahead.
+	 */
+	Range<StridedIterator<T, true>> prefetched(size_t distance) const {
+		return { { ptr, 1, 0, (ptrdiff_t) distance }, { ptr, 1, len } };
+	}
+};
+
+/**
+ * A view over size elements that are stride elements apart, such as a column
+ * of a matrix stored row by row.
+ *
+ * Like 'Span', bounds are only checked in debug builds.
+ */
+template<class T>
+class StridedSpan {
+	T* ptr;
+	size_t len;
+	ptrdiff_t step;
+public:
+	StridedSpan(T* data, size_t size, ptrdiff_t stride) :
+			ptr(data), len(size), step(stride) {
+	}
+
+	T* data() const {
+		return ptr;
+	}
+
+	size_t size() const {
+		return len;
+	}
+
+	ptrdiff_t stride() const {
+		return step;
+	}
+
+	T& operator[](size_t i) const {
+		assert(i < len);
+		return ptr[i * step];
+	}
+
+	StridedIterator<T> begin() const {
+		return StridedIterator<T>(ptr, step, 0);
+	}
+
+	StridedIterator<T> end() const {
+		return StridedIterator<T>(ptr, step, len);
+	}
+
+	/**
+	 * Returns a range that prefetches distance elements ahead.
+	 */
+	Range<StridedIterator<T, true>> prefetched(size_t distance) const {
+		return { { ptr, step, 0, (ptrdiff_t) distance }, { ptr, step, len } };
+	}
+};
+
+#endif /* SPAN_H_ */
@@ -0,0 +1,177 @@
+#include <cassert>
+#include <vector>
+#include "benchmark.h"
+#include "span.h"
+#include "span_tests.h"
+
+using namespace std;
+
+/**
+ * Tests a span over an array.
+ *
+ * A span is what an array decays to (a pointer) plus the size that would
+ * otherwise be lost, so out of bounds accesses can be caught.
+ */
+void test_span(void) {
+	long foo[] = { 1, 2, 3, 4, 5 };
+	Span<long> s = foo;
+	assert(s.size() == 5);
+	assert(s.data() == foo);
+
+	// Like a pointer, writing through a span writes to the array
+	s[0] = 10;
+	assert(foo[0] == 10);
+
+	long sum = 0;
+	for (long x : s) {
+		sum += x;
+	}
+	assert(sum == 10 + 2 + 3 + 4 + 5);
+
+	// A subspan is the equivalent of pointer arithmetic, with bounds
+	Span<long> t = s.subspan(2, 3);
+	assert(t.size() == 3);
+	assert(t[0] == 3);
+	assert(&t[2] == &foo[4]);
+
+	// In a debug build, the following code fails an assertion instead of
+	// reading whatever is after the array:
+	//
+	// s[5];
+	// s.subspan(4, 2);
+}
+
+/**
+ * Tests a strided span over a column of a multidimensional array.
+ */
+void test_strided_span(void) {
+	int foo[][3] = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+
+	// The second column starts at foo[0][1] and its elements are a row apart
+	StridedSpan<int> column(&foo[0][1], 3, 3);
+	assert(column.size() == 3);
+	assert(column[0] == 2);
+	assert(column[1] == 5);
+	assert(column[2] == 8);
+
+	column[2] = 0;
+	assert(foo[2][1] == 0);
+
+	int sum = 0;
+	for (int x : column) {
+		sum += x;
+	}
+	assert(sum == 2 + 5);
+
+	// The main diagonal is also a strided span
+	StridedSpan<int> diagonal(&foo[0][0], 3, 4);
+	assert(diagonal[1] == 5);
+	assert(diagonal[2] == 9);
+}
+
+/**
+ * Tests iterating with prefetching, which must visit the same elements.
+ */
+void test_prefetched(void) {
+	int foo[][2] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+
+	int sum = 0;
+	for (int x : StridedSpan<int>(&foo[0][0], 3, 2).prefetched(8)) {
+		sum += x;
+	}
+	assert(sum == 1 + 3 + 5);
+
+	sum = 0;
+	for (int x : Span<int>(&foo[0][0], 6).prefetched(8)) {
+		sum += x;
+	}
+	assert(sum == 21);
+}
+
+void run_span_tests(void) {
+	test_span();
+	test_strided_span();
+	test_prefetched();
+}
+
+/**
+ * Compares summing a buffer through a raw pointer and through a span.
+ *
+ * Without NDEBUG the span checks every index. With NDEBUG both loops should
+ * compile to the same code and run at the same speed.
+ */
+void bench_span_overhead(void) {
+	const size_t count = 1 << 16;
+	const int rounds = 20000;
+	vector<long> xs(count, 1);
+
+	long* p = xs.data();
+	double raw = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			long sum = 0;
+			for (size_t i = 0; i < count; i++) {
+				sum += p[i];
+			}
+			do_not_optimize(sum);
+		}
+	});
+	print_rate("raw pointer sum", (double) count * rounds, raw, "elems");
+
+	Span<long> s(xs.data(), xs.size());
+	double span = time_seconds([&] {
+		for (int r = 0; r < rounds; r++) {
+			long sum = 0;
+			for (size_t i = 0; i < s.size(); i++) {
+				sum += s[i];
+			}
+			do_not_optimize(sum);
+		}
+	});
+	print_rate("span sum", (double) count * rounds, span, "elems");
+}
+
+/**
+ * Sums one column per cache line of a large row major matrix, so that every
+ * element read is a cache miss, with and without prefetching.
+ */
+void bench_column_access(void) {
+	const size_t rows = 1 << 16;
+	const size_t cols = 1 << 10;
+	const size_t col_step = 64 / sizeof(int);
+	vector<int> matrix(rows * cols, 1);
+	double elems = (double) rows * (cols / col_step);
+
+	double plain = time_seconds([&] {
+		for (size_t c = 0; c < cols; c += col_step) {
+			long sum = 0;
+			for (int x : StridedSpan<int>(&matrix[c], rows, cols)) {
+				sum += x;
+			}
+			do_not_optimize(sum);
+		}
+	});
+	print_rate("column sum", elems, plain, "elems");
+
+	const size_t distances[] = { 4, 16, 64 };
+	for (size_t distance : distances) {
+		double prefetched = time_seconds([&] {
+			for (size_t c = 0; c < cols; c += col_step) {
+				long sum = 0;
+				StridedSpan<int> column(&matrix[c], rows, cols);
+				for (int x : column.prefetched(distance)) {
+					sum += x;
+				}
+				do_not_optimize(sum);
+			}
+		});
+		char name[64];
+		snprintf(name, sizeof(name), "column sum, prefetch %zu ahead",
+				distance);
+		print_rate(name, elems, prefetched, "elems");
+	}
+}
+
+void run_span_benchmarks(void) {
+	bench_span_overhead();
+	bench_column_access();
+}
@@ -0,0 +1,7 @@
+#ifndef SPAN_TESTS_H_
+#define SPAN_TESTS_H_
+
+void run_span_tests(void);
+void run_span_benchmarks(void);
+
+#endif /* SPAN_TESTS_H_ */
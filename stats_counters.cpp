@@ -0,0 +1,53 @@
+#include <mutex>
+#include <vector>
+#include "stats_counters.h"
+
+using namespace std;
+
+/**
+ * Numbers of threads that exited, to be given to new threads.
+ */
+struct ThreadIds {
+	mutex lock;
+	vector<size_t> free;
+	size_t next = 0;
+};
+
+// Never destroyed, since threads may still exit during static destruction
+static ThreadIds& thread_ids(void) {
+	static ThreadIds* ids = new ThreadIds;
+	return *ids;
+}
+
+/**
+ * Holds the number of a thread while it runs.
+ */
+struct ThreadId {
+	size_t id;
+
+	ThreadId() {
+		ThreadIds& ids = thread_ids();
+		lock_guard<mutex> guard(ids.lock);
+		if (ids.free.empty()) {
+			id = ids.next++;
+		} else {
+			id = ids.free.back();
+			ids.free.pop_back();
+		}
+	}
+
+	~ThreadId() {
+		ThreadIds& ids = thread_ids();
+		lock_guard<mutex> guard(ids.lock);
+		ids.free.push_back(id);
+		// Counting from destructors of other thread locals still works, with
+		// atomic adds since the number may already be taken again
+		cached_counter_thread_id = max_counter_threads + id;
+	}
+};
+
+size_t acquire_counter_thread_id(void) {
+	static thread_local ThreadId thread_id;
+	cached_counter_thread_id = thread_id.id;
+	return thread_id.id;
+}
@@ -0,0 +1,219 @@
+#ifndef STATS_COUNTERS_H_
+#define STATS_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "ring_buffer.h"
+
+/**
+ * How a thread adds to its slot of a sharded counter.
+ */
+enum class CounterMode {
+	// Atomic adds, so threads may share a slot, and fewer slots are needed
+	Atomic,
+	// Plain loads and stores, since each thread owns its slot
+	ThreadLocal
+};
+
+/**
+ * Most threads that can run at once with a slot of their own in a counter
+ * in thread local mode. Further threads share slots with atomic adds.
+ */
+constexpr size_t max_counter_threads = 256;
+
+/**
+ * Number of the calling thread, or SIZE_MAX until it asks for one.
+ */
+inline thread_local size_t cached_counter_thread_id = SIZE_MAX;
+
+size_t acquire_counter_thread_id(void);
+
+/**
+ * Returns a small number that identifies the calling thread among the
+ * running threads. The number of a thread that exits is given to the next
+ * new thread, so numbers stay below the most threads that ran at once.
+ */
+inline size_t counter_thread_id(void) {
+	size_t id = cached_counter_thread_id;
+	return id != SIZE_MAX ? id : acquire_counter_thread_id();
+}
+
+/**
+ * Returns the number of slots of a sharded counter: a slot per core in
+ * atomic mode, or a slot per possible thread and one shared by any further
+ * threads in thread local mode.
+ */
+template<CounterMode Mode>
+size_t counter_slot_count(void) {
+	if (Mode == CounterMode::ThreadLocal) {
+		return max_counter_threads + 1;
+	}
+	size_t n = 1;
+	while (n < std::thread::hardware_concurrency()) {
+		n *= 2;
+	}
+	return n;
+}
+
+/**
+ * Returns the slot of the calling thread among slot_count slots, and sets
+ * owned if no other thread writes to it.
+ */
+template<CounterMode Mode>
+inline size_t counter_slot(size_t slot_count, bool& owned) {
+	size_t id = counter_thread_id();
+	if (Mode == CounterMode::Atomic) {
+		owned = false;
+		return id % slot_count;
+	}
+	owned = id < max_counter_threads;
+	return owned ? id : max_counter_threads;
+}
+
+/**
+ * Adds n to a slot of a sharded counter.
+ *
+ * A slot owned by the calling thread is only written by it, so a read, an
+ * add and a write are enough, without a locked instruction, and readers
+ * still see whole values. Shared slots need atomic adds.
+ */
+inline void add_to_slot(std::atomic<long>& value, long n, bool owned) {
+	if (owned) {
+		value.store(value.load(std::memory_order_relaxed) + n,
+				std::memory_order_relaxed);
+	} else {
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Counter of events that many threads count at once.
+ *
+ * Each thread adds to its own slot, and every slot takes a whole cache
+ * line, so threads never write to the same cache line (false sharing) and
+ * adding scales with the number of cores. Reading adds up all slots, so it
+ * is slower, and while threads are adding it is only a recent value.
+ */
+template<CounterMode Mode = CounterMode::Atomic>
+class ShardedCounter {
+	struct alignas(cache_line_size) Slot {
+		std::atomic<long> value { 0 };
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t slot_count;
+public:
+	ShardedCounter() :
+			slots(new Slot[counter_slot_count<Mode>()]), slot_count(
+					counter_slot_count<Mode>()) {
+	}
+
+	void add(long n) {
+		bool owned;
+		size_t slot = counter_slot<Mode>(slot_count, owned);
+		add_to_slot(slots[slot].value, n, owned);
+	}
+
+	void increment() {
+		add(1);
+	}
+
+	long value() const {
+		long sum = 0;
+		for (size_t i = 0; i < slot_count; i++) {
+			sum += slots[i].value.load(std::memory_order_relaxed);
+		}
+		return sum;
+	}
+};
+
+/**
+ * Counts of a histogram, with a bucket per power of two.
+ */
+struct HistogramSnapshot {
+	static constexpr size_t bucket_count = 65;
+
+	long count = 0;
+	long sum = 0;
+	// Bucket 0 counts zeros and bucket b values in [2^(b-1), 2^b)
+	std::array<long, bucket_count> buckets { };
+
+	/**
+	 * Returns the bucket of a value.
+	 */
+	static size_t bucket_of(unsigned long value) {
+		return value ? 64 - __builtin_clzl(value) : 0;
+	}
+
+	/**
+	 * Returns an upper bound of the given quantile, between 0 and 1, which
+	 * is at most twice the exact value.
+	 */
+	unsigned long quantile(double q) const {
+		long rank = (long) (q * count);
+		if (rank >= count) {
+			rank = count - 1;
+		}
+		long seen = 0;
+		for (size_t b = 0; b < bucket_count; b++) {
+			seen += buckets[b];
+			if (seen > rank) {
+				return b == 0 ? 0 : b == 64 ? ~0ul : (1ul << b) - 1;
+			}
+		}
+		return ~0ul;
+	}
+
+	double mean() const {
+		return count ? (double) sum / count : 0;
+	}
+};
+
+/**
+ * Histogram of non negative values, such as latencies, that many threads
+ * record at once. Like 'ShardedCounter', each thread records to its own
+ * cache aligned slot, and a snapshot adds up all slots.
+ */
+template<CounterMode Mode = CounterMode::Atomic>
+class ShardedHistogram {
+	struct alignas(cache_line_size) Slot {
+		std::atomic<long> count { 0 };
+		std::atomic<long> sum { 0 };
+		std::atomic<long> buckets[HistogramSnapshot::bucket_count] { };
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t slot_count;
+public:
+	ShardedHistogram() :
+			slots(new Slot[counter_slot_count<Mode>()]), slot_count(
+					counter_slot_count<Mode>()) {
+	}
+
+	void record(unsigned long value) {
+		bool owned;
+		Slot& slot = slots[counter_slot<Mode>(slot_count, owned)];
+		add_to_slot(slot.buckets[HistogramSnapshot::bucket_of(value)], 1, owned);
+		add_to_slot(slot.count, 1, owned);
+		add_to_slot(slot.sum, value, owned);
+	}
+
+	HistogramSnapshot snapshot() const {
+		HistogramSnapshot s;
+		for (size_t i = 0; i < slot_count; i++) {
+			const Slot& slot = slots[i];
+			s.count += slot.count.load(std::memory_order_relaxed);
+			s.sum += slot.sum.load(std::memory_order_relaxed);
+			for (size_t b = 0; b < HistogramSnapshot::bucket_count; b++) {
+				s.buckets[b] += slot.buckets[b].load(std::memory_order_relaxed);
+			}
+		}
+		return s;
+	}
+};
+
+#endif /* STATS_COUNTERS_H_ */
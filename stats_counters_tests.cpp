@@ -0,0 +1,167 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "stats_counters.h"
+#include "stats_counters_tests.h"
+
+using namespace std;
+
+/**
+ * Tests that no increment is lost when many threads count at once, in
+ * both modes.
+ */
+template<CounterMode Mode>
+void test_sharded_counter(void) {
+	ShardedCounter<Mode> counter;
+	const int per_thread = 100000;
+	vector<thread> threads;
+	for (int t = 0; t < 8; t++) {
+		threads.emplace_back([&] {
+			for (int i = 0; i < per_thread; i++) {
+				counter.increment();
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+	assert(counter.value() == 8L * per_thread);
+
+	// Threads that exited gave their numbers to new threads, whose counts
+	// add to the same slots
+	for (int t = 0; t < 1000; t++) {
+		thread([&] {
+			counter.add(2);
+		}).join();
+	}
+	assert(counter.value() == 8L * per_thread + 2000);
+}
+
+/**
+ * Tests more threads running at once than have a slot of their own in
+ * thread local mode.
+ */
+void test_sharded_counter_overflow(void) {
+	ShardedCounter<CounterMode::ThreadLocal> counter;
+	const int count = max_counter_threads + 44;
+	atomic<int> started(0);
+	vector<thread> threads;
+	for (int t = 0; t < count; t++) {
+		threads.emplace_back([&] {
+			counter.increment();
+			// Keeps every thread alive until all have their number
+			started++;
+			while (started.load() < count) {
+				this_thread::yield();
+			}
+			counter.increment();
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+	assert(counter.value() == 2L * count);
+}
+
+/**
+ * Tests the buckets and quantiles of a histogram.
+ */
+void test_sharded_histogram(void) {
+	assert(HistogramSnapshot::bucket_of(0) == 0);
+	assert(HistogramSnapshot::bucket_of(1) == 1);
+	assert(HistogramSnapshot::bucket_of(7) == 3);
+	assert(HistogramSnapshot::bucket_of(8) == 4);
+	assert(HistogramSnapshot::bucket_of(~0ul) == 64);
+
+	ShardedHistogram<CounterMode::ThreadLocal> histogram;
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&] {
+			for (unsigned long v = 1; v <= 1000; v++) {
+				histogram.record(v);
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+	HistogramSnapshot s = histogram.snapshot();
+	assert(s.count == 4000);
+	assert(s.sum == 4 * 500500);
+	assert(s.buckets[1] == 4 && s.buckets[10] == 4 * (1000 - 511));
+	assert(s.mean() == 500.5);
+
+	// The median 500 is in [256, 512) and the maximum in [512, 1024)
+	assert(s.quantile(0.5) == 511);
+	assert(s.quantile(1) == 1023);
+	assert(s.quantile(0) == 1);
+}
+
+void run_stats_counters_tests(void) {
+	test_sharded_counter<CounterMode::Atomic>();
+	test_sharded_counter<CounterMode::ThreadLocal>();
+	test_sharded_counter_overflow();
+	test_sharded_histogram();
+}
+
+/**
+ * Runs the given number of threads, each calling increment(t) many times,
+ * and prints increments per second.
+ */
+template<class F>
+void bench_increments(const char* name, int threads, F increment) {
+	const long per_thread = 20000000 / threads;
+	double seconds = time_seconds([&] {
+		vector<thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&, t] {
+				for (long i = 0; i < per_thread; i++) {
+					increment(t);
+				}
+			});
+		}
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s, %d threads", name, threads);
+	print_rate(label, (double) per_thread * threads, seconds, "increments");
+}
+
+void run_stats_counters_benchmarks(void) {
+	int n = thread::hardware_concurrency();
+	// Doubles the threads up to all cores, whether n is a power of 2 or not
+	for (int threads = 1; threads <= n;
+			threads = threads < n && threads * 2 > n ? n : threads * 2) {
+		atomic<long> single(0);
+		bench_increments("single atomic<long>", threads, [&](int) {
+			single.fetch_add(1, memory_order_relaxed);
+		});
+
+		// Adjacent counters share cache lines
+		vector<atomic<long>> unpadded(threads);
+		bench_increments("unpadded per-thread array", threads, [&](int t) {
+			unpadded[t].fetch_add(1, memory_order_relaxed);
+		});
+
+		ShardedCounter<CounterMode::Atomic> atomic_counter;
+		bench_increments("ShardedCounter (atomic)", threads, [&](int) {
+			atomic_counter.increment();
+		});
+
+		ShardedCounter<CounterMode::ThreadLocal> local_counter;
+		bench_increments("ShardedCounter (local)", threads, [&](int) {
+			local_counter.increment();
+		});
+
+		ShardedHistogram<CounterMode::ThreadLocal> histogram;
+		bench_increments("ShardedHistogram (local)", threads,
+				[&](int t) {
+					histogram.record(t + 100);
+				});
+	}
+}
@@ -0,0 +1,7 @@
+#ifndef STATS_COUNTERS_TESTS_H_
+#define STATS_COUNTERS_TESTS_H_
+
+void run_stats_counters_tests(void);
+void run_stats_counters_benchmarks(void);
+
+#endif /* STATS_COUNTERS_TESTS_H_ */
@@ -0,0 +1,296 @@
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <sys/mman.h>
+#include "thread_cache_alloc.h"
+
+using namespace std;
+
+/**
+ * Start of every slab and of every large allocation, found by rounding an
+ * address down to the slab size.
+ */
+struct SlabHeader {
+	// The size class, or -1 for a large allocation
+	int size_class;
+	// Bytes mapped, for a large allocation
+	size_t bytes;
+};
+
+struct FreeSlot {
+	FreeSlot* next;
+};
+
+static constexpr size_t slab_bytes = 256 << 10;
+static constexpr size_t header_bytes = 64;
+static constexpr int transfer_slots = 64;
+
+/**
+ * Shared free slots of a size class.
+ *
+ * Full batches are kept in transfer slots, so they can be handed to a
+ * thread as they are. Slots that do not make a full batch are kept in a
+ * loose list, and new slots are carved from the newest slab.
+ */
+struct alignas(64) CentralCache {
+	mutex lock;
+	FreeSlot* batches[transfer_slots];
+	int batch_count;
+	FreeSlot* loose;
+	size_t loose_count;
+	char* carve;
+	char* carve_end;
+};
+
+/**
+ * Free slots of one size class cached by a thread.
+ */
+struct FreeList {
+	FreeSlot* head;
+	size_t count;
+};
+
+// Constant initialized, so they can be used before any constructor runs
+static CentralCache central[tc_class_count];
+static atomic<size_t> reserved { 0 };
+
+static thread_local FreeList cache[tc_class_count];
+
+// Whether the cache of the thread is not yet in use, in use, or gone
+enum CacheState {
+	Unused, Active, Destroyed
+};
+static thread_local CacheState cache_state;
+
+/**
+ * Returns the number of slots moved at a time between a thread and the
+ * central cache, which is fewer for larger slots.
+ */
+static size_t batch_size(int size_class) {
+	size_t n = 32768 / tc_class_size(size_class);
+	return n < 2 ? 2 : n > 64 ? 64 : n;
+}
+
+static SlabHeader* header_of(void* p) {
+	return (SlabHeader*) ((uintptr_t) p & ~(uintptr_t) (slab_bytes - 1));
+}
+
+/**
+ * Maps bytes of memory aligned to the slab size, or returns null.
+ */
+static void* map_aligned(size_t bytes) {
+	// Maps a slab more than needed and unmaps what is outside the alignment
+	size_t padded = bytes + slab_bytes;
+	void* memory = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return nullptr;
+	}
+	uintptr_t start = (uintptr_t) memory;
+	uintptr_t aligned = (start + slab_bytes - 1) & ~(uintptr_t) (slab_bytes - 1);
+	if (aligned > start) {
+		munmap(memory, aligned - start);
+	}
+	size_t after = start + padded - (aligned + bytes);
+	if (after > 0) {
+		munmap((void*) (aligned + bytes), after);
+	}
+	reserved.fetch_add(bytes, memory_order_relaxed);
+	return (void*) aligned;
+}
+
+/**
+ * Takes up to n slots of a size class from the central cache, returning
+ * them as a list and their number in count.
+ */
+static FreeSlot* fetch(int size_class, size_t n, size_t& count) {
+	CentralCache& c = central[size_class];
+	lock_guard<mutex> guard(c.lock);
+	if (n == batch_size(size_class) && c.batch_count > 0) {
+		count = n;
+		return c.batches[--c.batch_count];
+	}
+
+	FreeSlot* head = nullptr;
+	count = 0;
+	while (count < n && c.loose) {
+		FreeSlot* slot = c.loose;
+		c.loose = slot->next;
+		slot->next = head;
+		head = slot;
+		count++;
+	}
+	c.loose_count -= count;
+
+	size_t size = tc_class_size(size_class);
+	while (count < n) {
+		if (c.carve + size > c.carve_end) {
+			// The rest of a full batch can come from the transfer slots
+			if (count == 0 && c.batch_count > 0) {
+				count = batch_size(size_class);
+				FreeSlot* batch = c.batches[--c.batch_count];
+				// Only happens when fewer than a batch were asked for
+				while (count > n) {
+					FreeSlot* slot = batch;
+					batch = batch->next;
+					slot->next = c.loose;
+					c.loose = slot;
+					c.loose_count++;
+					count--;
+				}
+				return batch;
+			}
+			char* slab = (char*) map_aligned(slab_bytes);
+			if (!slab) {
+				break;
+			}
+			SlabHeader* header = (SlabHeader*) slab;
+			header->size_class = size_class;
+			header->bytes = slab_bytes;
+			c.carve = slab + header_bytes;
+			c.carve_end = slab + slab_bytes;
+		}
+		FreeSlot* slot = (FreeSlot*) c.carve;
+		c.carve += size;
+		slot->next = head;
+		head = slot;
+		count++;
+	}
+	return head;
+}
+
+/**
+ * Gives a list of count slots back to the central cache.
+ */
+static void release(int size_class, FreeSlot* head, size_t count) {
+	CentralCache& c = central[size_class];
+	lock_guard<mutex> guard(c.lock);
+	if (count == batch_size(size_class) && c.batch_count < transfer_slots) {
+		c.batches[c.batch_count++] = head;
+		return;
+	}
+	while (head) {
+		FreeSlot* slot = head;
+		head = head->next;
+		slot->next = c.loose;
+		c.loose = slot;
+	}
+	c.loose_count += count;
+}
+
+/**
+ * Gives all slots cached by the thread back when it exits. Frees after
+ * that, from destructors of other thread locals, go to the central cache.
+ */
+struct CacheReaper {
+	~CacheReaper() {
+		for (int i = 0; i < tc_class_count; i++) {
+			if (cache[i].head) {
+				release(i, cache[i].head, cache[i].count);
+			}
+			cache[i] = FreeList { };
+		}
+		cache_state = Destroyed;
+	}
+};
+
+/**
+ * Marks the cache of the thread in use, so it is emptied when the thread
+ * exits. Returns false if it is already gone.
+ */
+static bool use_cache(void) {
+	if (cache_state == Unused) {
+		static thread_local CacheReaper reaper;
+		cache_state = Active;
+	}
+	return cache_state == Active;
+}
+
+static void* allocate_large(size_t size) {
+	size_t bytes = (size + header_bytes + 4095) & ~(size_t) 4095;
+	char* memory = (char*) map_aligned(bytes);
+	if (!memory) {
+		return nullptr;
+	}
+	SlabHeader* header = (SlabHeader*) memory;
+	header->size_class = -1;
+	header->bytes = bytes;
+	return memory + header_bytes;
+}
+
+/**
+ * Refills the empty cache of a size class and allocates from it.
+ */
+static void* allocate_slow(int size_class) {
+	size_t count;
+	if (!use_cache()) {
+		return fetch(size_class, 1, count);
+	}
+	FreeList& list = cache[size_class];
+	list.head = fetch(size_class, batch_size(size_class), list.count);
+	if (!list.head) {
+		return nullptr;
+	}
+	FreeSlot* slot = list.head;
+	list.head = slot->next;
+	list.count--;
+	return slot;
+}
+
+void* tc_allocate(size_t size) {
+	if (size > tc_max_small) {
+		return allocate_large(size);
+	}
+	int size_class = tc_size_class(size);
+	FreeList& list = cache[size_class];
+	FreeSlot* slot = list.head;
+	if (!slot) {
+		return allocate_slow(size_class);
+	}
+	list.head = slot->next;
+	list.count--;
+	return slot;
+}
+
+void tc_free(void* p) {
+	if (!p) {
+		return;
+	}
+	SlabHeader* header = header_of(p);
+	int size_class = header->size_class;
+	if (size_class < 0) {
+		reserved.fetch_sub(header->bytes, memory_order_relaxed);
+		munmap(header, header->bytes);
+		return;
+	}
+
+	FreeSlot* slot = (FreeSlot*) p;
+	if (cache_state != Active && !use_cache()) {
+		slot->next = nullptr;
+		release(size_class, slot, 1);
+		return;
+	}
+	FreeList& list = cache[size_class];
+	slot->next = list.head;
+	list.head = slot;
+	list.count++;
+
+	// Keeps up to two batches, so a thread alternating between allocating
+	// and freeing around a batch boundary does not go back and forth
+	size_t batch = batch_size(size_class);
+	if (list.count > 2 * batch) {
+		FreeSlot* head = list.head;
+		FreeSlot* last = head;
+		for (size_t i = 1; i < batch; i++) {
+			last = last->next;
+		}
+		list.head = last->next;
+		list.count -= batch;
+		last->next = nullptr;
+		release(size_class, head, batch);
+	}
+}
+
+size_t tc_reserved_bytes(void) {
+	return reserved.load(memory_order_relaxed);
+}
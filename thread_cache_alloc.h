@@ -0,0 +1,75 @@
+#ifndef THREAD_CACHE_ALLOC_H_
+#define THREAD_CACHE_ALLOC_H_
+
+#include <cstddef>
+
+/**
+ * Number of size classes of small allocations.
+ */
+constexpr int tc_class_count = 36;
+
+/**
+ * Largest size of a small allocation. Larger ones are mapped on their own.
+ */
+constexpr size_t tc_max_small = 16384;
+
+/**
+ * Returns the size class of a small allocation of the given size.
+ *
+ * Classes go up 16 bytes at a time to 128 bytes, then in four steps per
+ * power of two, so no more than a fifth of an allocation is wasted.
+ */
+constexpr int tc_size_class(size_t size) {
+	if (size <= 128) {
+		return size == 0 ? 0 : (int) ((size - 1) >> 4);
+	}
+	int log = 63 - __builtin_clzll(size - 1);
+	return 8 + (log - 7) * 4 + (int) ((size - 1) >> (log - 2)) - 4;
+}
+
+/**
+ * Returns the size of the slots of a size class.
+ */
+constexpr size_t tc_class_size(int size_class) {
+	if (size_class < 8) {
+		return 16 * (size_class + 1);
+	}
+	int log = 7 + (size_class - 8) / 4;
+	return ((size_t) 1 << log)
+			+ (size_t) ((size_class - 8) % 4 + 1) * ((size_t) 1 << (log - 2));
+}
+
+static_assert(tc_class_size(tc_class_count - 1) == tc_max_small);
+static_assert(tc_size_class(tc_max_small) == tc_class_count - 1);
+static_assert(tc_size_class(129) == 8 && tc_class_size(8) == 160);
+
+/**
+ * Allocates size bytes aligned to 16 bytes, like malloc, returning null if
+ * there is no memory left.
+ *
+ * Each thread keeps a cache of free slots per size class, so most
+ * allocations and frees take no lock. A thread whose cache runs out takes a
+ * batch of slots from the central cache of the class, and a thread whose
+ * cache holds too many gives a batch back, so slots freed by one thread are
+ * reused by others. Batches move whole between threads and the central
+ * cache's transfer slots, one lock per batch rather than per slot.
+ *
+ * Slots are carved from slabs aligned to their size, whose header records
+ * the size class, so freeing needs no size. Allocations larger than
+ * 'tc_max_small' are mapped and unmapped on their own.
+ */
+void* tc_allocate(size_t size);
+
+/**
+ * Frees memory from 'tc_allocate', which may have been allocated by another
+ * thread. Null is ignored.
+ */
+void tc_free(void* p);
+
+/**
+ * Returns the bytes taken from the system by all threads, including free
+ * slots in caches.
+ */
+size_t tc_reserved_bytes(void);
+
+#endif /* THREAD_CACHE_ALLOC_H_ */
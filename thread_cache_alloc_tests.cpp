@@ -0,0 +1,243 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "ring_buffer.h"
+#include "thread_cache_alloc.h"
+#include "thread_cache_alloc_tests.h"
+
+using namespace std;
+
+/**
+ * Tests that every size maps to a class that holds it, and that classes
+ * grow with the size.
+ */
+void test_size_classes(void) {
+	int last = 0;
+	for (size_t size = 0; size <= tc_max_small; size++) {
+		int c = tc_size_class(size);
+		assert(c >= last && c < tc_class_count);
+		assert(tc_class_size(c) >= size);
+		assert(c == 0 || tc_class_size(c - 1) < size);
+		assert(tc_class_size(c) % 16 == 0);
+		last = c;
+	}
+}
+
+/**
+ * Tests allocations of every size, small and large, holding their own
+ * contents.
+ */
+void test_tc_allocate(void) {
+	vector<pair<unsigned char*, size_t>> blocks;
+	for (size_t size = 0; size < 40000; size += size < 512 ? 1 : 97) {
+		unsigned char* p = (unsigned char*) tc_allocate(size);
+		assert(p);
+		assert((uintptr_t) p % 16 == 0);
+		memset(p, size & 0xff, size);
+		blocks.push_back({p, size});
+	}
+	for (auto [p, size] : blocks) {
+		for (size_t i = 0; i < size; i++) {
+			assert(p[i] == (size & 0xff));
+		}
+		tc_free(p);
+	}
+	tc_free(nullptr);
+
+	// Freed slots are reused
+	void* p = tc_allocate(24);
+	tc_free(p);
+	assert(tc_allocate(24) == p);
+	tc_free(p);
+}
+
+/**
+ * Tests freeing on other threads, including threads that have exited with
+ * slots still in their caches.
+ */
+void test_tc_threads(void) {
+	const int count = 50000;
+	vector<long*> blocks(count);
+	thread producer([&] {
+		for (int i = 0; i < count; i++) {
+			blocks[i] = (long*) tc_allocate(sizeof(long) * (1 + i % 8));
+			*blocks[i] = i;
+		}
+	});
+	producer.join();
+
+	// Blocks the consumers allocate, freed here once they have exited
+	vector<vector<void*>> kept(4);
+	vector<thread> consumers;
+	for (int t = 0; t < 4; t++) {
+		consumers.emplace_back([&, t] {
+			for (int i = t; i < count; i += 4) {
+				assert(*blocks[i] == i);
+				tc_free(blocks[i]);
+			}
+			// Leaves some in the cache of this thread
+			for (int i = 0; i < 100; i++) {
+				kept[t].push_back(tc_allocate(64));
+			}
+		});
+	}
+	for (thread& consumer : consumers) {
+		consumer.join();
+	}
+	for (vector<void*>& thread_blocks : kept) {
+		for (void* p : thread_blocks) {
+			tc_free(p);
+		}
+	}
+}
+
+void run_thread_cache_alloc_tests(void) {
+	test_size_classes();
+	test_tc_allocate();
+	test_tc_threads();
+}
+
+/**
+ * The general purpose allocator of the C library.
+ */
+struct Malloc {
+	static void* allocate(size_t size) {
+		return malloc(size);
+	}
+
+	static void free(void* p) {
+		::free(p);
+	}
+
+	static size_t reserved_bytes(void) {
+		struct mallinfo2 info = mallinfo2();
+		return info.arena + info.hblkhd;
+	}
+};
+
+struct ThreadCache {
+	static void* allocate(size_t size) {
+		return tc_allocate(size);
+	}
+
+	static void free(void* p) {
+		tc_free(p);
+	}
+
+	static size_t reserved_bytes(void) {
+		return tc_reserved_bytes();
+	}
+};
+
+/**
+ * Returns a random size, mostly small as in typical programs.
+ */
+static size_t random_size(mt19937& random) {
+	unsigned r = random();
+	return r % 8 != 0 ? 8 + r % 120 : r % 16 != 0 ? 128 + r % 896 : 1024 + r % 7168;
+}
+
+/**
+ * Each thread keeps a window of live blocks and keeps replacing a random
+ * one with a block of a random size.
+ */
+template<class A>
+void bench_churn(const char* name, int threads) {
+	const int window = 1000;
+	const int rounds = 2000000 / threads;
+	size_t before = A::reserved_bytes();
+	double seconds = time_seconds([&] {
+		vector<thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&, t] {
+				mt19937 random(t);
+				vector<void*> blocks(window);
+				for (void*& p : blocks) {
+					p = A::allocate(random_size(random));
+				}
+				for (int r = 0; r < rounds; r++) {
+					void*& p = blocks[random() % window];
+					A::free(p);
+					p = A::allocate(random_size(random));
+					do_not_optimize(p);
+				}
+				for (void* p : blocks) {
+					A::free(p);
+				}
+			});
+		}
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s churn, %d threads", name, threads);
+	print_rate(label, (double) rounds * threads, seconds, "allocs+frees");
+	printf("%-40s %12.3f MB reserved\n", label,
+			((double) A::reserved_bytes() - before) / (1 << 20));
+}
+
+/**
+ * Pairs of threads where one allocates and passes the blocks through a ring
+ * to the other, which frees them, so every block is freed by a thread other
+ * than the one that allocated it.
+ */
+template<class A>
+void bench_producer_consumer(const char* name, int pairs) {
+	const int count = 1000000 / pairs;
+	size_t before = A::reserved_bytes();
+	vector<SpscRing<void*, 1024>> rings(pairs);
+	double seconds = time_seconds([&] {
+		vector<thread> workers;
+		for (int t = 0; t < pairs; t++) {
+			SpscRing<void*, 1024>& ring = rings[t];
+			workers.emplace_back([&ring, count, t] {
+				mt19937 random(t);
+				for (int i = 0; i < count; i++) {
+					void* p = A::allocate(random_size(random));
+					while (!ring.push(p)) {
+						this_thread::yield();
+					}
+				}
+			});
+			workers.emplace_back([&ring, count] {
+				for (int i = 0; i < count; i++) {
+					void* p;
+					while (!ring.pop(p)) {
+						this_thread::yield();
+					}
+					A::free(p);
+				}
+			});
+		}
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	});
+	char label[64];
+	snprintf(label, sizeof(label), "%s prod/cons, %d pairs", name, pairs);
+	print_rate(label, (double) count * pairs, seconds, "allocs+frees");
+	printf("%-40s %12.3f MB reserved\n", label,
+			((double) A::reserved_bytes() - before) / (1 << 20));
+}
+
+void run_thread_cache_alloc_benchmarks(void) {
+	int n = thread::hardware_concurrency();
+	// Doubles the threads up to all cores, whether n is a power of 2 or not
+	for (int threads = 1; threads <= n;
+			threads = threads < n && threads * 2 > n ? n : threads * 2) {
+		bench_churn<Malloc>("malloc", threads);
+		bench_churn<ThreadCache>("tc_allocate", threads);
+	}
+	for (int pairs = 1; pairs <= max(n / 2, 1); pairs *= 2) {
+		bench_producer_consumer<Malloc>("malloc", pairs);
+		bench_producer_consumer<ThreadCache>("tc_allocate", pairs);
+	}
+}
@@ -0,0 +1,7 @@
+#ifndef THREAD_CACHE_ALLOC_TESTS_H_
+#define THREAD_CACHE_ALLOC_TESTS_H_
+
+void run_thread_cache_alloc_tests(void);
+void run_thread_cache_alloc_benchmarks(void);
+
+#endif /* THREAD_CACHE_ALLOC_TESTS_H_ */
@@ -0,0 +1,28 @@
+/**
+ * Replaces the global operator new and delete with the thread caching
+ * allocator when built with -DTHREAD_CACHE_GLOBAL_NEW, so that a dedicated
+ * test binary runs every test on it. Array, nothrow and sized forms all
+ * forward to these.
+ */
+#ifdef THREAD_CACHE_GLOBAL_NEW
+
+#include <new>
+#include "thread_cache_alloc.h"
+
+void* operator new(size_t size) {
+	void* p = tc_allocate(size);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	tc_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	tc_free(p);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "thread_pool.h"
+
+using namespace std;
+
+/**
+ * Progress of a loop, shared by every thread working on it.
+ *
+ * A worker may only start once the loop is over, after the caller has
+ * returned, so it holds the state by a shared pointer and never touches the
+ * body once all chunks have been taken.
+ */
+struct LoopState {
+	size_t begin;
+	size_t end;
+	size_t grain;
+	size_t chunks;
+	const function<void(size_t, size_t)>* body;
+	atomic<size_t> next { 0 };
+	atomic<size_t> done { 0 };
+	mutex lock;
+	condition_variable finished;
+
+	/**
+	 * Runs chunks until there are none left.
+	 */
+	void run(void) {
+		size_t chunk;
+		while ((chunk = next.fetch_add(1)) < chunks) {
+			size_t from = begin + chunk * grain;
+			(*body)(from, min(from + grain, end));
+			if (done.fetch_add(1) + 1 == chunks) {
+				lock_guard<mutex> guard(lock);
+				finished.notify_all();
+			}
+		}
+	}
+};
+
+ThreadPool::ThreadPool(size_t worker_count) :
+		stopping(false) {
+	for (size_t i = 0; i < worker_count; i++) {
+		workers.emplace_back([this] {
+			work();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	ready.notify_all();
+	for (thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::work(void) {
+	for (;;) {
+		function<void()> task;
+		{
+			unique_lock<mutex> guard(lock);
+			ready.wait(guard, [this] {
+				return stopping || !tasks.empty();
+			});
+			if (tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain,
+		const function<void(size_t, size_t)>& body) {
+	if (begin >= end) {
+		return;
+	}
+	grain = max(grain, (size_t) 1);
+	size_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1 || workers.empty()) {
+		for (size_t from = begin; from < end; from += grain) {
+			body(from, min(from + grain, end));
+		}
+		return;
+	}
+
+	shared_ptr<LoopState> state = make_shared<LoopState>();
+	state->begin = begin;
+	state->end = end;
+	state->grain = grain;
+	state->chunks = chunks;
+	state->body = &body;
+
+	size_t helpers = min(workers.size(), chunks - 1);
+	{
+		lock_guard<mutex> guard(lock);
+		for (size_t i = 0; i < helpers; i++) {
+			tasks.push_back([state] {
+				state->run();
+			});
+		}
+	}
+	ready.notify_all();
+
+	// Works on the loop too, which also means a loop nested in a worker
+	// finishes even when every other worker is busy
+	state->run();
+	unique_lock<mutex> guard(state->lock);
+	state->finished.wait(guard, [&] {
+		return state->done.load() == chunks;
+	});
+}
+
+ThreadPool& shared_pool(void) {
+	static ThreadPool pool(max(thread::hardware_concurrency(), 1u) - 1);
+	return pool;
+}
@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads that run loops in parallel.
+ *
+ * The thread calling 'parallel_for' works on the loop too, so a pool of n
+ * workers runs a loop on n + 1 threads, and a pool of no workers runs it on
+ * the calling thread alone.
+ */
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex lock;
+	std::condition_variable ready;
+	bool stopping;
+
+	void work(void);
+public:
+	explicit ThreadPool(size_t worker_count);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Returns the number of threads a loop runs on.
+	 */
+	size_t size(void) const {
+		return workers.size() + 1;
+	}
+
+	/**
+	 * Calls body(chunk_begin, chunk_end) for consecutive chunks of grain
+	 * indices covering [begin, end), on all threads of the pool, and returns
+	 * once all chunks are done.
+	 *
+	 * Threads take chunks one at a time, so a smaller grain balances uneven
+	 * work better and a larger one has less overhead. The body may itself
+	 * call 'parallel_for'.
+	 */
+	void parallel_for(size_t begin, size_t end, size_t grain,
+			const std::function<void(size_t, size_t)>& body);
+};
+
+/**
+ * Returns the pool shared by the whole program, with a thread per core.
+ */
+ThreadPool& shared_pool(void);
+
+#endif /* THREAD_POOL_H_ */
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include "trace.h"
+
+using namespace std;
+
+/**
+ * Every trace buffer, and a timestamp and time taken together when the
+ * first one was created, to convert timestamps to time.
+ */
+struct TraceRegistry {
+	mutex lock;
+	vector<TraceBuffer*> buffers;
+	uint64_t start_ticks;
+	chrono::steady_clock::time_point start_time;
+	const char* exit_path = nullptr;
+};
+
+// Never destroyed, like the buffers, since threads may still record spans
+// during static destruction
+static TraceRegistry& registry(void) {
+	static TraceRegistry* r = [] {
+		TraceRegistry* r = new TraceRegistry;
+		r->start_ticks = trace_clock();
+		r->start_time = chrono::steady_clock::now();
+		return r;
+	}();
+	return *r;
+}
+
+TraceBuffer::TraceBuffer(unsigned thread_index, size_t max_events) :
+		head(new Chunk), tail(head), max_chunks(
+				(max_events + chunk_events - 1) / chunk_events), thread_index(
+				thread_index) {
+}
+
+TraceBuffer::~TraceBuffer() {
+	for (Chunk* c = head; c;) {
+		Chunk* next = c->next.load(memory_order_relaxed);
+		delete c;
+		c = next;
+	}
+}
+
+bool TraceBuffer::grow() {
+	if (chunks >= max_chunks) {
+		return false;
+	}
+	Chunk* chunk = new Chunk;
+	tail->next.store(chunk, memory_order_release);
+	tail = chunk;
+	chunks++;
+	return true;
+}
+
+TraceBuffer* create_trace_buffer(void) {
+	TraceRegistry& r = registry();
+	lock_guard<mutex> guard(r.lock);
+	TraceBuffer* buffer = new TraceBuffer(r.buffers.size());
+	r.buffers.push_back(buffer);
+	thread_trace_buffer = buffer;
+	return buffer;
+}
+
+/**
+ * Writes a JSON string.
+ */
+static void write_json_string(FILE* file, const char* s) {
+	fputc('"', file);
+	for (; *s; s++) {
+		unsigned char c = *s;
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+void write_chrome_trace(FILE* file) {
+	TraceRegistry& r = registry();
+	lock_guard<mutex> guard(r.lock);
+
+	// Timestamps are converted to microseconds with the rate at which they
+	// went up since the first buffer was created
+	uint64_t ticks = trace_clock() - r.start_ticks;
+	double nanoseconds = chrono::duration<double, nano>(
+			chrono::steady_clock::now() - r.start_time).count();
+	double us_per_tick = ticks > 0 ? nanoseconds / ticks / 1000 : 0;
+
+	fprintf(file, "{\"traceEvents\":[");
+	bool first = true;
+	size_t dropped = 0;
+	for (const TraceBuffer* buffer : r.buffers) {
+		dropped += buffer->dropped();
+		buffer->for_each([&](const TraceEvent& event) {
+			fprintf(file, first ? "\n" : ",\n");
+			first = false;
+			fprintf(file, "{\"name\":");
+			write_json_string(file, event.name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+					"\"ts\":%.3f,\"dur\":%.3f}", buffer->thread_index,
+					(double) (int64_t) (event.begin - r.start_ticks) * us_per_tick,
+					(double) (event.end - event.begin) * us_per_tick);
+		});
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ns\"");
+	if (dropped > 0) {
+		fprintf(file, ",\"otherData\":{\"droppedSpans\":%zu}", dropped);
+	}
+	fprintf(file, "}\n");
+}
+
+void trace_at_exit(const char* path) {
+	TraceRegistry& r = registry();
+	bool first;
+	{
+		lock_guard<mutex> guard(r.lock);
+		first = r.exit_path == nullptr;
+		r.exit_path = path;
+	}
+	if (first) {
+		atexit([] {
+			FILE* file = fopen(registry().exit_path, "w");
+			if (!file) {
+				perror(registry().exit_path);
+				return;
+			}
+			write_chrome_trace(file);
+			fclose(file);
+		});
+	}
+}
@@ -0,0 +1,183 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Returns a timestamp for tracing: the time stamp counter of the CPU where
+ * there is one, which is read in a few cycles, or else nanoseconds of the
+ * steady clock. Timestamps are only converted to time when written out.
+ */
+inline uint64_t trace_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * A span of time in a thread. The name must outlive the trace, like a
+ * string literal or '__func__'.
+ */
+struct TraceEvent {
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+/**
+ * Spans recorded by one thread.
+ *
+ * Only the owning thread appends, so appending takes no lock and no atomic
+ * read-modify-write. Spans are stored in chunks that are never moved, and
+ * the count of a chunk is published after its spans, so a reader on
+ * another thread always sees whole spans.
+ *
+ * A buffer holds at most max_events spans, rounded up to whole chunks, so
+ * a long running program does not run out of memory. Later spans are
+ * dropped and only counted.
+ */
+class TraceBuffer {
+	static constexpr size_t chunk_events = 4096;
+
+	struct Chunk {
+		TraceEvent events[chunk_events];
+		std::atomic<size_t> count { 0 };
+		std::atomic<Chunk*> next { nullptr };
+	};
+
+	Chunk* head;
+	Chunk* tail;
+	size_t chunks = 1;
+	const size_t max_chunks;
+	std::atomic<size_t> lost { 0 };
+
+	bool grow();
+public:
+	/**
+	 * Default number of spans a thread keeps, which take 24 MB.
+	 */
+	static constexpr size_t default_max_events = 1 << 20;
+
+	const unsigned thread_index;
+
+	explicit TraceBuffer(unsigned thread_index, size_t max_events =
+			default_max_events);
+	~TraceBuffer();
+
+	TraceBuffer(const TraceBuffer&) = delete;
+	TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+	void append(const TraceEvent& event) {
+		size_t n = tail->count.load(std::memory_order_relaxed);
+		if (n == chunk_events) {
+			if (!grow()) {
+				lost.store(lost.load(std::memory_order_relaxed) + 1,
+						std::memory_order_relaxed);
+				return;
+			}
+			n = 0;
+		}
+		tail->events[n] = event;
+		tail->count.store(n + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Returns how many spans were dropped because the buffer was full.
+	 */
+	size_t dropped() const {
+		return lost.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Calls func with every span recorded so far.
+	 */
+	template<class F>
+	void for_each(F func) const {
+		for (const Chunk* c = head; c;
+				c = c->next.load(std::memory_order_acquire)) {
+			size_t n = c->count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < n; i++) {
+				func(c->events[i]);
+			}
+		}
+	}
+};
+
+/**
+ * Buffer of the calling thread, or null until it records a span.
+ */
+inline thread_local TraceBuffer* thread_trace_buffer = nullptr;
+
+TraceBuffer* create_trace_buffer(void);
+
+inline TraceBuffer& local_trace_buffer(void) {
+	TraceBuffer* buffer = thread_trace_buffer;
+	return buffer ? *buffer : *create_trace_buffer();
+}
+
+/**
+ * Records the time from its construction to its destruction as a span of
+ * the calling thread, or in a buffer of the caller's own, which is not part
+ * of the trace that is written out.
+ */
+class TraceSpan {
+	TraceBuffer& buffer;
+	const char* name;
+	uint64_t begin;
+public:
+	explicit TraceSpan(const char* name) :
+			TraceSpan(name, local_trace_buffer()) {
+	}
+
+	TraceSpan(const char* name, TraceBuffer& buffer) :
+			buffer(buffer), name(name), begin(trace_clock()) {
+	}
+
+	~TraceSpan() {
+		uint64_t end = trace_clock();
+		buffer.append( { name, begin, end });
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/**
+ * Traces the rest of the enclosing scope under the given name, or the
+ * enclosing function. Unless built with -DTRACING, they compile to nothing.
+ */
+#ifdef TRACING
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+#else
+#define TRACE_SCOPE(name) ((void) 0)
+#define TRACE_FUNCTION() ((void) 0)
+#endif
+
+/**
+ * Writes all spans recorded so far by every thread, including threads that
+ * have exited, as Chrome trace event JSON, which Perfetto and
+ * chrome://tracing open. The number of spans dropped by full buffers, if
+ * any, is written as "droppedSpans" in "otherData".
+ */
+void write_chrome_trace(FILE* file);
+
+/**
+ * Writes the trace to the given file when the program exits.
+ */
+void trace_at_exit(const char* path);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,144 @@
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "trace.h"
+#include "trace_tests.h"
+
+using namespace std;
+
+/**
+ * Returns how many times needle appears in text.
+ */
+static size_t count_of(const string& text, const string& needle) {
+	size_t n = 0;
+	for (size_t i = text.find(needle); i != string::npos;
+			i = text.find(needle, i + 1)) {
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Returns the trace written so far as a string.
+ */
+static string trace_text(void) {
+	FILE* file = tmpfile();
+	assert(file);
+	write_chrome_trace(file);
+	rewind(file);
+	string text;
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		text.append(buffer, n);
+	}
+	fclose(file);
+	return text;
+}
+
+/**
+ * Tests that spans of several threads, nested and more than fit in a
+ * chunk, are all written out.
+ */
+void test_trace(void) {
+	vector<thread> threads;
+	for (int t = 0; t < 3; t++) {
+		threads.emplace_back([] {
+			TraceSpan outer("trace test \"outer\"");
+			for (int i = 0; i < 5000; i++) {
+				TraceSpan inner("trace test inner");
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+
+	// Threads that exited keep their spans
+	string text = trace_text();
+	assert(text.rfind("{\"traceEvents\":[", 0) == 0);
+	assert(text.find("]") != string::npos);
+	assert(count_of(text, "\"trace test \\\"outer\\\"\"") == 3);
+	assert(count_of(text, "\"trace test inner\"") == 3 * 5000);
+	assert(count_of(text, "\"ph\":\"X\"") == count_of(text, "\"dur\":"));
+	assert(text.find("\"dur\":-") == string::npos);
+
+	// Spans of the macros are only recorded when tracing is built in
+	{
+		TRACE_SCOPE("trace test macro");
+		TRACE_FUNCTION();
+	}
+	text = trace_text();
+#ifdef TRACING
+	assert(count_of(text, "\"trace test macro\"") == 1);
+	assert(count_of(text, "\"test_trace\"") == 1);
+#else
+	assert(count_of(text, "\"trace test macro\"") == 0);
+#endif
+}
+
+/**
+ * Tests that a buffer of the caller's own drops the spans past its limit,
+ * and that its spans are not part of the trace.
+ */
+void test_trace_buffer_limit(void) {
+	TraceBuffer buffer(0, 10000);
+	for (int i = 0; i < 20000; i++) {
+		TraceSpan span("trace test limited", buffer);
+	}
+	// The limit is rounded up to three chunks of 4096 spans
+	size_t kept = 0;
+	buffer.for_each([&](const TraceEvent& event) {
+		assert(event.end >= event.begin);
+		kept++;
+	});
+	assert(kept == 3 * 4096);
+	assert(buffer.dropped() == 20000 - kept);
+	assert(count_of(trace_text(), "\"trace test limited\"") == 0);
+}
+
+void run_trace_tests(void) {
+	test_trace();
+	test_trace_buffer_limit();
+}
+
+/**
+ * Measures the cost of a span, which is taking two timestamps and appending
+ * to a buffer, and of the timestamps alone. The spans go to a buffer of the
+ * benchmark's own, so they are freed afterwards and not written out.
+ */
+void bench_trace(void) {
+	const int spans = 4000000;
+	TraceBuffer* buffer = new TraceBuffer(0, spans);
+	double seconds = time_seconds([&] {
+		for (int i = 0; i < spans; i++) {
+			TraceSpan span("trace benchmark", *buffer);
+		}
+	});
+	assert(buffer->dropped() == 0);
+	delete buffer;
+	printf("%-40s %12.3f ns\n", "TraceSpan", seconds / spans * 1e9);
+
+	seconds = time_seconds([&] {
+		for (int i = 0; i < spans; i++) {
+			do_not_optimize(trace_clock());
+			do_not_optimize(trace_clock());
+		}
+	});
+	printf("%-40s %12.3f ns\n", "two trace_clock", seconds / spans * 1e9);
+
+	seconds = time_seconds([&] {
+		for (int i = 0; i < spans; i++) {
+			do_not_optimize(chrono::steady_clock::now());
+			do_not_optimize(chrono::steady_clock::now());
+		}
+	});
+	printf("%-40s %12.3f ns\n", "two steady_clock::now", seconds / spans * 1e9);
+}
+
+void run_trace_benchmarks(void) {
+	bench_trace();
+}
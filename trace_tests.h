@@ -0,0 +1,7 @@
+#ifndef TRACE_TESTS_H_
+#define TRACE_TESTS_H_
+
+void run_trace_tests(void);
+void run_trace_benchmarks(void);
+
+#endif /* TRACE_TESTS_H_ */
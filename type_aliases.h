@@ -0,0 +1,13 @@
+#ifndef TYPE_ALIASES_H_
+#define TYPE_ALIASES_H_
+
+#include <string>
+
+/*
+ * The original style was borrowed from C.
+ */
+typedef char Char;
+typedef const char* CString;
+typedef std::string String;
+
+#endif /* TYPE_ALIASES_H_ */
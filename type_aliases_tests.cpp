@@ -2,6 +2,7 @@
 #include <cstring>
 #include <string>
 #include <vector>
+#include "type_aliases.h"
 
 /*
  * A type alias is an alias to an already existing type. Type aliases can be
@@ -16,11 +17,8 @@
  */
 
 /*
- * The original style was borrowed from C.
+ * The original style was borrowed from C. See type_aliases.h.
  */
-typedef char Char;
-typedef const char* CString;
-typedef std::string String;
 
 /*
  * The preferred new C++11 type alias syntax has an advantage over templates.
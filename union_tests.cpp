@@ -1,4 +1,5 @@
 #include "union_tests.h"
+#include "unions.h"
 #include <cassert>
 
 /**
@@ -11,19 +12,6 @@ union MyUnion {
 	unsigned long l;
 };
 
-/**
- * An anonymous union is a union without a name. An anonymous union can appear
- * inside a class, structure or union. The access of members of an anonymous
- * union is differs from a named union.
- */
-struct MyStruct {
-	int id;
-	union {
-		int i;
-		long l;
-	};
-};
-
 /**
  * Tests a union.
  */
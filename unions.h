@@ -0,0 +1,17 @@
+#ifndef UNIONS_H_
+#define UNIONS_H_
+
+/**
+ * An anonymous union is a union without a name. An anonymous union can appear
+ * inside a class, structure or union. The access of members of an anonymous
+ * union is differs from a named union.
+ */
+struct MyStruct {
+	int id;
+	union {
+		int i;
+		long l;
+	};
+};
+
+#endif /* UNIONS_H_ */